@@ -0,0 +1,268 @@
+/*******************************************************************************
+ * Name        : biguint.h
+ * Description : Arbitrary-precision unsigned integer with Karatsuba
+ *               multiplication, shared by the stair counts in
+ *               PA3StairClimber and the high-precision mode of Lab1's sqrt.
+ ******************************************************************************/
+#ifndef BIGUINT_H_
+#define BIGUINT_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Unsigned big integer stored as base 10^9 limbs, least significant first, so
+ * printing needs no base conversion. Multiplication switches to Karatsuba for
+ * long operands.
+ */
+class BigUInt {
+public:
+    BigUInt(unsigned long long value = 0) {
+        while(value > 0) {
+            limbs_.push_back((unsigned) (value % BASE));
+            value /= BASE;
+        }
+    }
+
+    /**
+     * Parses a string of decimal digits; returns false on any other character
+     * or an empty string.
+     */
+    static bool from_string(const std::string &digits, BigUInt &result) {
+        if(digits.empty()) {
+            return false;
+        }
+        result.limbs_.clear();
+        for(size_t end = digits.size(); end > 0; ) {
+            size_t begin = end >= 9 ? end - 9 : 0;
+            unsigned limb = 0;
+            for(size_t i = begin; i < end; i++) {
+                if(digits[i] < '0' || digits[i] > '9') {
+                    return false;
+                }
+                limb = limb * 10 + (unsigned) (digits[i] - '0');
+            }
+            result.limbs_.push_back(limb);
+            end = begin;
+        }
+        trim(result.limbs_);
+        return true;
+    }
+
+    /**
+     * Number of base 10^9 limbs; zero has none.
+     */
+    size_t size() const {
+        return limbs_.size();
+    }
+
+    bool is_zero() const {
+        return limbs_.empty();
+    }
+
+    BigUInt& operator+=(const BigUInt &rhs) {
+        add_shifted(limbs_, rhs.limbs_, 0);
+        return *this;
+    }
+
+    BigUInt operator+(const BigUInt &rhs) const {
+        BigUInt sum(*this);
+        return sum += rhs;
+    }
+
+    /**
+     * this - rhs, where this >= rhs
+     */
+    BigUInt operator-(const BigUInt &rhs) const {
+        BigUInt difference(*this);
+        subtract(difference.limbs_, rhs.limbs_);
+        return difference;
+    }
+
+    BigUInt operator*(const BigUInt &rhs) const {
+        BigUInt product;
+        product.limbs_ = multiply(limbs_, rhs.limbs_);
+        return product;
+    }
+
+    bool operator<(const BigUInt &rhs) const {
+        return compare(limbs_, rhs.limbs_) < 0;
+    }
+
+    bool operator<=(const BigUInt &rhs) const {
+        return compare(limbs_, rhs.limbs_) <= 0;
+    }
+
+    /**
+     * this * BASE^count
+     */
+    BigUInt shifted_up(size_t count) const {
+        BigUInt result;
+        if(!limbs_.empty()) {
+            result.limbs_.assign(count, 0);
+            result.limbs_.insert(result.limbs_.end(), limbs_.begin(), limbs_.end());
+        }
+        return result;
+    }
+
+    /**
+     * floor(this / BASE^count)
+     */
+    BigUInt shifted_down(size_t count) const {
+        BigUInt result;
+        if(count < limbs_.size()) {
+            result.limbs_.assign(limbs_.begin() + count, limbs_.end());
+        }
+        return result;
+    }
+
+    /**
+     * floor(this / 2)
+     */
+    BigUInt halved() const {
+        BigUInt result(*this);
+        unsigned remainder = 0;
+        for(size_t i = result.limbs_.size(); i-- > 0; ) {
+            unsigned long long cur = result.limbs_[i] + (unsigned long long) remainder * BASE;
+            result.limbs_[i] = (unsigned) (cur / 2);
+            remainder = (unsigned) (cur % 2);
+        }
+        trim(result.limbs_);
+        return result;
+    }
+
+    /**
+     * Approximates this / BASE^scale from the three leading limbs.
+     */
+    double scaled_down(size_t scale) const {
+        double value = 0;
+        size_t lowest = limbs_.size() > 3 ? limbs_.size() - 3 : 0;
+        for(size_t i = limbs_.size(); i-- > lowest; ) {
+            value = value * BASE + limbs_[i];
+        }
+        return value * std::pow((double) BASE, (double) lowest - (double) scale);
+    }
+
+    std::string to_string() const {
+        if(limbs_.empty()) {
+            return "0";
+        }
+        std::ostringstream oss;
+        oss << limbs_.back();
+        for(size_t i = limbs_.size() - 1; i-- > 0; ) {
+            oss << std::setw(9) << std::setfill('0') << limbs_[i];
+        }
+        return oss.str();
+    }
+
+    static const unsigned BASE = 1000000000;
+
+private:
+    typedef std::vector<unsigned> limbs_t;
+    // Operands shorter than this many limbs are multiplied the schoolbook way.
+    static const size_t KARATSUBA_THRESHOLD = 32;
+
+    limbs_t limbs_;
+
+    static void trim(limbs_t &a) {
+        while(!a.empty() && a.back() == 0) {
+            a.pop_back();
+        }
+    }
+
+    static int compare(const limbs_t &a, const limbs_t &b) {
+        if(a.size() != b.size()) {
+            return a.size() < b.size() ? -1 : 1;
+        }
+        for(size_t i = a.size(); i-- > 0; ) {
+            if(a[i] != b[i]) {
+                return a[i] < b[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * a += b * BASE^shift
+     */
+    static void add_shifted(limbs_t &a, const limbs_t &b, size_t shift) {
+        if(a.size() < b.size() + shift) {
+            a.resize(b.size() + shift, 0);
+        }
+        unsigned carry = 0;
+        size_t i = 0;
+        for(; i < b.size() || carry; i++) {
+            if(shift + i == a.size()) {
+                a.push_back(0);
+            }
+            unsigned sum = a[shift + i] + carry + (i < b.size() ? b[i] : 0);
+            carry = sum >= BASE;
+            a[shift + i] = carry ? sum - BASE : sum;
+        }
+    }
+
+    /**
+     * a -= b, where a >= b
+     */
+    static void subtract(limbs_t &a, const limbs_t &b) {
+        unsigned borrow = 0;
+        for(size_t i = 0; i < b.size() || borrow; i++) {
+            unsigned sub = borrow + (i < b.size() ? b[i] : 0);
+            borrow = a[i] < sub;
+            a[i] = borrow ? a[i] + BASE - sub : a[i] - sub;
+        }
+        trim(a);
+    }
+
+    static limbs_t schoolbook(const limbs_t &a, const limbs_t &b) {
+        limbs_t result(a.size() + b.size(), 0);
+        for(size_t i = 0; i < a.size(); i++) {
+            unsigned long long carry = 0;
+            for(size_t j = 0; j < b.size() || carry; j++) {
+                unsigned long long cur = result[i + j] + carry +
+                    (j < b.size() ? (unsigned long long) a[i] * b[j] : 0);
+                result[i + j] = (unsigned) (cur % BASE);
+                carry = cur / BASE;
+            }
+        }
+        trim(result);
+        return result;
+    }
+
+    /**
+     * Karatsuba multiplication: three half-size products instead of four.
+     */
+    static limbs_t multiply(const limbs_t &a, const limbs_t &b) {
+        if(std::min(a.size(), b.size()) < KARATSUBA_THRESHOLD) {
+            return schoolbook(a, b);
+        }
+        size_t half = std::max(a.size(), b.size()) / 2;
+        limbs_t a0(a.begin(), a.begin() + std::min(half, a.size()));
+        limbs_t a1(a.begin() + std::min(half, a.size()), a.end());
+        limbs_t b0(b.begin(), b.begin() + std::min(half, b.size()));
+        limbs_t b1(b.begin() + std::min(half, b.size()), b.end());
+        trim(a0);
+        trim(b0);
+
+        limbs_t z0 = multiply(a0, b0);
+        limbs_t z2 = multiply(a1, b1);
+        add_shifted(a0, a1, 0);
+        add_shifted(b0, b1, 0);
+        limbs_t z1 = multiply(a0, b0);
+        subtract(z1, z0);
+        subtract(z1, z2);
+
+        limbs_t result(z0);
+        add_shifted(result, z1, half);
+        add_shifted(result, z2, 2 * half);
+        trim(result);
+        return result;
+    }
+};
+
+#endif /* BIGUINT_H_ */
@@ -1,43 +1,386 @@
 /*******************************************************************************
  * Filename: sqrt.cpp
  * Description: Lab 1: Computes the square root of num to the precision defined by epsilon (if provided).
+ *              With --digits, computes the square root of an arbitrarily large
+ *              decimal value to the given number of decimal places.
  ******************************************************************************/
 
 #include <iostream>
 #include <iomanip>
 #include <limits>
 #include <sstream>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <random>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+#include "../Common/biguint.h"
 using namespace std;
 
+// Bit pattern that turns half of a double's bits into an estimate of
+// 1/sqrt(x) (the double-precision "fast inverse square root" constant),
+// and the largest relative error of that estimate over all normal x.
+const uint64_t RSQRT_MAGIC = 0x5FE6EB50C7B537A9ULL;
+const double RSQRT_SEED_ERROR = 0.0344;
+// Four steps take the seed error below 1e-20, past double precision.
+const int MAX_NEWTON_STEPS = 4;
+
+/**
+ * Returns the estimate of 1/sqrt(num) read off num's exponent and mantissa
+ * bits. num must be positive and normal.
+ */
+double rsqrt_seed(double num) {
+    uint64_t bits;
+    memcpy(&bits, &num, sizeof bits);
+    bits = RSQRT_MAGIC - (bits >> 1);
+    memcpy(&num, &bits, sizeof bits);
+    return num;
+}
+
+/**
+ * Returns how many Newton steps r = r * (3 - x * r * r) / 2 take the seed's
+ * relative error below epsilon. Each step maps an error e to at most
+ * 1.5 e^2 + 0.5 e^3, starting from RSQRT_SEED_ERROR.
+ */
+int newton_steps(double epsilon) {
+    double error = RSQRT_SEED_ERROR;
+    int steps = 0;
+    while(error > epsilon && steps < MAX_NEWTON_STEPS) {
+        error = 1.5 * error * error + 0.5 * error * error * error;
+        steps++;
+    }
+    return steps;
+}
+
+/**
+ * Square root of one value for sqrt_batch(): rsqrt seed, a fixed number of
+ * Newton steps, then sqrt(x) = x * (1/sqrt(x)). Values that are not positive
+ * and normal (zero, negatives, subnormals, infinities, NaN) are handled
+ * separately.
+ */
+double sqrt_lane(double num, int steps) {
+    if(!(num >= numeric_limits<double>::min() && num <= numeric_limits<double>::max())) {
+        if(num < 0) {
+            return numeric_limits<double>::quiet_NaN();
+        }
+        if(num > 0 && num < numeric_limits<double>::min()) {
+            // Subnormal: scale into the normal range by an even power of two
+            return ldexp(sqrt_lane(ldexp(num, 104), steps), -52);
+        }
+        return num;                     // 0, +infinity and NaN
+    }
+    double r = rsqrt_seed(num);
+    for(int i = 0; i < steps; i++) {
+        r = r * (1.5 - 0.5 * num * r * r);
+    }
+    return num * r;
+}
+
+/**
+ * Computes out[i] = sqrt(in[i]) for n values, to a relative error of at most
+ * epsilon (|out[i] - sqrt(in[i])| <= epsilon * sqrt(in[i])), plus a few ulps
+ * of rounding; the error cannot go below that. Unlike sqrt(num, epsilon),
+ * there is no convergence loop: each value is seeded from its exponent bits
+ * and gets the same small number of division-free Newton steps, chosen up
+ * front from epsilon, so 8 (AVX-512) or 4 (AVX2) values go through the steps
+ * side by side. Lanes that are not positive and normal are patched
+ * afterwards by sqrt_lane(). in and out may be the same array.
+ */
+void sqrt_batch(const double in[], double out[], size_t n, double epsilon) {
+    const int steps = newton_steps(epsilon);
+    size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512i magic = _mm512_set1_epi64(RSQRT_MAGIC);
+    const __m512d half = _mm512_set1_pd(0.5), three_halves = _mm512_set1_pd(1.5);
+    const __m512d lowest = _mm512_set1_pd(numeric_limits<double>::min());
+    const __m512d highest = _mm512_set1_pd(numeric_limits<double>::max());
+    for(; i + 8 <= n; i += 8) {
+        __m512d x = _mm512_loadu_pd(in + i);
+        __m512d r = _mm512_castsi512_pd(
+            _mm512_sub_epi64(magic, _mm512_srli_epi64(_mm512_castpd_si512(x), 1)));
+        __m512d half_x = _mm512_mul_pd(half, x);
+        for(int step = 0; step < steps; step++) {
+            r = _mm512_mul_pd(r, _mm512_fnmadd_pd(half_x, _mm512_mul_pd(r, r), three_halves));
+        }
+        _mm512_storeu_pd(out + i, _mm512_mul_pd(x, r));
+        __mmask8 normal = _mm512_cmp_pd_mask(x, lowest, _CMP_GE_OQ) &
+                          _mm512_cmp_pd_mask(x, highest, _CMP_LE_OQ);
+        if(normal != 0xFF) {
+            // Patch from x: with in == out, in[i..i+7] is already overwritten
+            double lanes[8];
+            _mm512_storeu_pd(lanes, x);
+            for(int lane = 0; lane < 8; lane++) {
+                if(!(normal & (1 << lane))) {
+                    out[i + lane] = sqrt_lane(lanes[lane], steps);
+                }
+            }
+        }
+    }
+#elif defined(__AVX2__)
+    const __m256i magic = _mm256_set1_epi64x(RSQRT_MAGIC);
+    const __m256d half = _mm256_set1_pd(0.5), three_halves = _mm256_set1_pd(1.5);
+    const __m256d lowest = _mm256_set1_pd(numeric_limits<double>::min());
+    const __m256d highest = _mm256_set1_pd(numeric_limits<double>::max());
+    for(; i + 4 <= n; i += 4) {
+        __m256d x = _mm256_loadu_pd(in + i);
+        __m256d r = _mm256_castsi256_pd(
+            _mm256_sub_epi64(magic, _mm256_srli_epi64(_mm256_castpd_si256(x), 1)));
+        __m256d half_x = _mm256_mul_pd(half, x);
+        for(int step = 0; step < steps; step++) {
+            __m256d t = _mm256_sub_pd(three_halves, _mm256_mul_pd(half_x, _mm256_mul_pd(r, r)));
+            r = _mm256_mul_pd(r, t);
+        }
+        __m256d normal = _mm256_and_pd(_mm256_cmp_pd(x, lowest, _CMP_GE_OQ),
+                                       _mm256_cmp_pd(x, highest, _CMP_LE_OQ));
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(x, r));
+        int normal_mask = _mm256_movemask_pd(normal);
+        if(normal_mask != 0xF) {
+            // Patch from x: with in == out, in[i..i+3] is already overwritten
+            double lanes[4];
+            _mm256_storeu_pd(lanes, x);
+            for(int lane = 0; lane < 4; lane++) {
+                if(!(normal_mask & (1 << lane))) {
+                    out[i + lane] = sqrt_lane(lanes[lane], steps);
+                }
+            }
+        }
+    }
+#endif
+    for(; i < n; i++) {
+        out[i] = sqrt_lane(in[i], steps);
+    }
+}
+
 double sqrt(double num, double epsilon) {
     if(num < 0) {
         return numeric_limits<double>::quiet_NaN();
     }
     
-    if(num == 0 || num == 1) {
+    if(num == 0 || num == 1 || !(num <= numeric_limits<double>::max())) {
         return num;
     }
 
-    double last_guess = num;
-    double next_guess = 0;
+    // Starting from the bit-level estimate instead of num itself saves the
+    // long run of halvings Newton's method needs when num is far from 1. The
+    // first step lands at or above the root; from there the guesses only
+    // decrease.
+    double last_guess = num >= numeric_limits<double>::min() ? num * rsqrt_seed(num) : num;
+    double next_guess = (last_guess + num/last_guess) / 2;
 
     while(!(abs(last_guess - next_guess) <= epsilon)) {
-        if(next_guess != 0){
-            last_guess = next_guess;
-        }
+        last_guess = next_guess;
         next_guess = (last_guess + num/last_guess) / 2;
+        // Once they stop decreasing, rounding has taken over and epsilon is
+        // finer than the spacing of doubles near the root
+        if(next_guess >= last_guess) {
+            return last_guess;
+        }
     }
 
     return next_guess;
 
 }
 
+/**
+ * Returns floor(sqrt(num)).
+ *
+ * With s = ceil(limbs / 2), x = num / BASE^(2s) lies in [BASE^-2, 1), and
+ * sqrt(num) = num * (1/sqrt(x)) / BASE^s. 1/sqrt(x) is refined as a fixed
+ * point number R / BASE^q with the division-free Newton step
+ * r' = r + r(1 - x r^2) / 2, starting from a double estimate (q = 1) and
+ * doubling q each step, with x read to only as many limbs as q needs. The
+ * steps cost a geometric series of multiplications, so the whole root costs a
+ * few full-size multiplications instead of a division per step. The last
+ * rounding error is removed by checking the candidate against num.
+ */
+BigUInt isqrt(const BigUInt &num) {
+    if(num.is_zero()) {
+        return num;
+    }
+    const size_t s = (num.size() + 1) / 2;
+    // One guard limb beyond the root's length keeps the final error to a few units
+    const size_t precision = s + 1;
+
+    size_t q = 1;
+    BigUInt r((unsigned long long) (BigUInt::BASE / sqrt(num.scaled_down(2 * s))));
+    while(q < precision) {
+        size_t next_q = min(2 * q, precision);
+        // x with scale BASE^scale_x, at least next_q significant limbs
+        size_t scale_x = min(2 * s, next_q + 2);
+        BigUInt x = num.shifted_down(2 * s - scale_x);
+
+        // x r^2 with scale BASE^(scale_x + 2q), and 1 at the same scale
+        BigUInt product = x * (r * r);
+        BigUInt one = BigUInt(1).shifted_up(scale_x + 2 * q);
+        bool below_one = product <= one;
+        BigUInt residual = below_one ? one - product : product - one;
+
+        // r * residual / 2 rescaled to BASE^next_q; the residual only needs
+        // next_q + 1 limbs after the point
+        size_t drop = scale_x + 2 * q - (next_q + 1);
+        BigUInt correction = (r * residual.shifted_down(drop)).shifted_down(q + 1).halved();
+        r = r.shifted_up(next_q - q);
+        r = below_one ? r + correction : r - correction;
+        q = next_q;
+    }
+
+    BigUInt root = (num * r).shifted_down(s + precision);
+    BigUInt one(1);
+    while(!root.is_zero() && num < root * root) {
+        root = root - one;
+    }
+    while((root + one) * (root + one) <= num) {
+        root = root + one;
+    }
+    return root;
+}
+
+/**
+ * Returns sqrt(value) truncated to the given number of decimal places, where
+ * value is a non-negative decimal string such as "2" or "0.0625". Uses
+ * floor(sqrt(value) * 10^digits) = isqrt(floor(value * 10^(2 digits))).
+ * Returns an empty string if value is malformed.
+ */
+string decimal_sqrt(const string &value, size_t digits) {
+    size_t point = value.find('.');
+    string whole = value.substr(0, point);
+    string fraction = point == string::npos ? "" : value.substr(point + 1);
+    if(whole.empty() && fraction.empty()) {
+        return "";
+    }
+    if(whole.find_first_not_of("0123456789") != string::npos ||
+       fraction.find_first_not_of("0123456789") != string::npos) {
+        return "";
+    }
+
+    // value * 10^(2 digits), truncated to an integer
+    size_t kept = min(fraction.size(), 2 * digits);
+    string scaled = whole + fraction.substr(0, kept);
+    scaled.append(2 * digits - kept, '0');
+    if(scaled.empty()) {
+        scaled = "0";
+    }
+    BigUInt num;
+    BigUInt::from_string(scaled, num);
+
+    string root = isqrt(num).to_string();
+    if(digits == 0) {
+        return root;
+    }
+    if(root.size() <= digits) {
+        root.insert(0, digits + 1 - root.size(), '0');
+    }
+    root.insert(root.size() - digits, ".");
+    return root;
+}
+
+/**
+ * Cross-checks sqrt_batch() against std::sqrt() on length random values (any
+ * bit pattern, so every exponent, plus values of everyday size) with the
+ * special values 0, -0, infinities, NaN, negatives and subnormals scattered
+ * through them, so that they land in every lane of the vector paths. Runs at
+ * several epsilons, out of place and in place. Returns true if every result
+ * is within epsilon plus a few ulps, or is exactly the special value
+ * std::sqrt() gives.
+ */
+bool check_sqrt_batch(size_t length) {
+    const double specials[] = {
+        0.0, -0.0, numeric_limits<double>::infinity(), -numeric_limits<double>::infinity(),
+        numeric_limits<double>::quiet_NaN(), -1.0, -numeric_limits<double>::min(),
+        numeric_limits<double>::denorm_min(), numeric_limits<double>::min() / 3,
+        numeric_limits<double>::min(), numeric_limits<double>::max(), 1.0
+    };
+    const size_t num_specials = sizeof(specials) / sizeof(specials[0]);
+    const double epsilons[] = {1e-4, 1e-7, 1e-12, 1e-16};
+    const double ulps = 4 * numeric_limits<double>::epsilon();
+
+    mt19937_64 rng(length);
+    uniform_real_distribution<double> everyday(0.0, 1e6);
+    vector<double> values(length);
+    for(size_t i = 0; i < length; i++) {
+        if(i % 7 == 3) {
+            values[i] = specials[(i / 7) % num_specials];
+        } else if(i % 2 == 0) {
+            uint64_t bits = rng() & ~(1ULL << 63);
+            memcpy(&values[i], &bits, sizeof bits);
+        } else {
+            values[i] = everyday(rng);
+        }
+    }
+
+    bool ok = true;
+    for(size_t e = 0; e < sizeof(epsilons) / sizeof(epsilons[0]); e++) {
+        double epsilon = epsilons[e];
+        vector<double> out(length), in_place(values);
+        sqrt_batch(&values[0], &out[0], length, epsilon);
+        sqrt_batch(&in_place[0], &in_place[0], length, epsilon);
+        for(size_t i = 0; i < length; i++) {
+            double expected = std::sqrt(values[i]);
+            bool matches;
+            if(std::isnan(expected)) {
+                matches = std::isnan(out[i]) && std::isnan(in_place[i]);
+            } else if(expected == 0 || std::isinf(expected)) {
+                matches = out[i] == expected && signbit(out[i]) == signbit(expected) &&
+                          in_place[i] == out[i];
+            } else {
+                matches = abs(out[i] - expected) <= (epsilon + ulps) * expected &&
+                          in_place[i] == out[i];
+            }
+            if(!matches) {
+                cerr << "Error: sqrt_batch(" << setprecision(17) << values[i]
+                     << ") returned " << out[i] << " (in place " << in_place[i]
+                     << ") with epsilon " << epsilon << "; std::sqrt gives "
+                     << expected << "." << endl;
+                ok = false;
+            }
+        }
+    }
+    return ok;
+}
+
 int main(int argc, char* argv[]) {
     double n, eps;
     istringstream iss;
 
+    if(argc == 4 && string(argv[1]) == "--digits") {
+        size_t digits;
+        iss.str(argv[2]);
+        if(!(iss >> digits) || !iss.eof() || argv[2][0] == '-') {
+            cerr << "Error: Digits argument must be a non-negative integer." << endl;
+            return 1;
+        }
+        string root = decimal_sqrt(argv[3], digits);
+        if(root.empty()) {
+            cerr << "Error: Value argument must be a non-negative decimal number." << endl;
+            return 1;
+        }
+        cout << root << endl;
+        return 0;
+    }
+
+    if(argc == 3 && string(argv[1]) == "--check") {
+        size_t length;
+        iss.str(argv[2]);
+        if(!(iss >> length) || !iss.eof() || length == 0 || argv[2][0] == '-') {
+            cerr << "Error: Length argument must be a positive integer." << endl;
+            return 1;
+        }
+        if(!check_sqrt_batch(length)) {
+            return 1;
+        }
+        cout << "sqrt_batch agrees with std::sqrt on " << length << " values." << endl;
+        return 0;
+    }
+
     if(argc != 3 && argc != 2) {
-        cerr << "Usage: " << argv[0] << " <value> [epsilon]" << endl;
+        cerr << "Usage: " << argv[0] << " <value> [epsilon]" << endl
+             << "       " << argv[0] << " --digits <n> <value>" << endl
+             << "       " << argv[0] << " --check <length>" << endl;
         return 1;
     }
 
@@ -8,16 +8,48 @@
 #include <limits>
 #include <sstream>
 #include <vector>
+#include <string>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <map>
+#include <set>
+#include <tuple>
+#include <random>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
 class Student {
     public:
-        Student(string first, string last, float gpa, int id) : first_{first}, last_{last}, gpa_{gpa}, id_{id} { };
+        // The names are taken by value and moved in, so callers passing
+        // temporaries or std::move()d strings (e.g. through emplace_back) pay
+        // for no copies.
+        Student(string first, string last, float gpa, int id) : first_{std::move(first)}, last_{std::move(last)}, gpa_{gpa}, id_{id} { };
 
         string full_name() const {
             return first_ + " " + last_;
         }
 
+        const string& first_name() const {
+            return first_;
+        }
+
+        const string& last_name() const {
+            return last_;
+        }
+
         int id() const {
             return id_;
         }
@@ -27,7 +59,8 @@ class Student {
         }
 
         void print_info() const {
-            cout << full_name() << ", GPA: " << fixed << setprecision(2) << gpa() << ", ID: " << id();
+            // Writes the names directly rather than building full_name()
+            cout << first_ << ' ' << last_ << ", GPA: " << fixed << setprecision(2) << gpa() << ", ID: " << id();
         }
 
     private:
@@ -38,22 +71,34 @@ class Student {
 };
 
 /**
-* Takes a vector of Student objects, and returns a new vector
-* with all Students whose GPA is < 1.0.
+* A filtered view of a vector of Students: pointers to the matching records,
+* valid for as long as the vector is neither resized nor destroyed.
 */
-vector<Student> find_failing_students(const vector<Student> &students) {
-    vector<Student> failing_students;
-
-    // Iterates through the students vector, appending each student whose gpa is
-    // less than 1.0 to the failing_students vector.
+typedef vector<const Student*> student_view_t;
 
+/**
+* Takes a vector of Student objects and returns a view of those for which
+* matches(student) is true. No Student is copied.
+*/
+template <typename Predicate>
+student_view_t filter_students(const vector<Student> &students, Predicate matches) {
+    student_view_t view;
     for(size_t i = 0; i < students.size(); i++) {
-        if(students[i].gpa() < 1.0) {
-            failing_students.push_back(students[i]);
+        if(matches(students[i])) {
+            view.push_back(&students[i]);
         }
     }
+    return view;
+}
 
-    return failing_students;
+/**
+* Takes a vector of Student objects, and returns a view of all Students
+* whose GPA is < 1.0.
+*/
+student_view_t find_failing_students(const vector<Student> &students) {
+    return filter_students(students, [](const Student &student) {
+        return student.gpa() < 1.0;
+    });
 }
 
 /**
@@ -67,12 +112,1223 @@ void print_students(const vector<Student> &students) {
     }
 }
 
+/**
+* Takes a view of Student objects and prints them to the screen.
+*/
+void print_students(const student_view_t &students) {
+    for(size_t i = 0; i < students.size(); i++) {
+        students[i]->print_info();
+        cout << "\n";
+    }
+}
+
+/**
+ * Interned strings stored back to back in one character arena. Each distinct
+ * string gets a 32-bit number; a string seen many times is stored once.
+ */
+class NamePool {
+    public:
+        size_t size() const {
+            return offset_.size();
+        }
+
+        size_t arena_bytes() const {
+            return arena_.size();
+        }
+
+        const char* data(uint32_t number) const {
+            return arena_.data() + offset_[number];
+        }
+
+        uint32_t length(uint32_t number) const {
+            return length_[number];
+        }
+
+        string name(uint32_t number) const {
+            return string(data(number), length_[number]);
+        }
+
+        void write(uint32_t number) const {
+            cout.write(data(number), length_[number]);
+        }
+
+        /**
+         * Returns the number of the given string, storing it in the arena the
+         * first time it is seen.
+         */
+        uint32_t intern(const char *str, size_t length) {
+            // Keep the table at most half full
+            if(2 * (offset_.size() + 1) > slots_.size()) {
+                rebuild_slots(slots_.empty() ? 1024 : 2 * slots_.size());
+            }
+            Slot key = make_slot(str, length, 0);
+            size_t mask = slots_.size() - 1;
+            for(size_t slot = hash(str, length) & mask; ; slot = (slot + 1) & mask) {
+                Slot &entry = slots_[slot];
+                if(entry.number == 0) {
+                    uint32_t number = (uint32_t) offset_.size();
+                    offset_.push_back((uint32_t) arena_.size());
+                    length_.push_back((uint32_t) length);
+                    arena_.insert(arena_.end(), str, str + length);
+                    entry = key;
+                    entry.number = number + 1;
+                    return number;
+                }
+                // Short strings are compared within the slot, without touching
+                // the arena; longer ones only on a matching prefix
+                if(entry.length == key.length && memcmp(entry.prefix, key.prefix, PREFIX_BYTES) == 0 &&
+                   (length <= PREFIX_BYTES ||
+                    memcmp(data(entry.number - 1) + PREFIX_BYTES, str + PREFIX_BYTES,
+                           length - PREFIX_BYTES) == 0)) {
+                    return entry.number - 1;
+                }
+            }
+        }
+
+        /**
+         * Writes the pool as its offsets, lengths and arena, in that order.
+         */
+        void save(FILE *file) const {
+            fwrite(offset_.data(), sizeof(uint32_t), offset_.size(), file);
+            fwrite(length_.data(), sizeof(uint32_t), length_.size(), file);
+            fwrite(arena_.data(), 1, arena_.size(), file);
+        }
+
+        /**
+         * Replaces the pool with count strings read in the layout written by
+         * save(). Returns false if a string would lie outside the arena.
+         */
+        bool load(const uint32_t *offsets, const uint32_t *lengths, size_t count,
+                  const char *arena, size_t arena_bytes) {
+            for(size_t i = 0; i < count; i++) {
+                if(offsets[i] > arena_bytes || lengths[i] > arena_bytes - offsets[i]) {
+                    return false;
+                }
+            }
+            offset_.assign(offsets, offsets + count);
+            length_.assign(lengths, lengths + count);
+            arena_.assign(arena, arena + arena_bytes);
+            size_t slots = 1024;
+            while(slots < 2 * (count + 1)) {
+                slots *= 2;
+            }
+            rebuild_slots(slots);
+            return true;
+        }
+
+    private:
+        vector<char> arena_;
+        vector<uint32_t> offset_;
+        vector<uint32_t> length_;
+        static const size_t PREFIX_BYTES = 8;
+        struct Slot {
+            uint32_t number;                // String number + 1, 0 marking an empty slot
+            uint32_t length;
+            char prefix[PREFIX_BYTES];      // Leading bytes of the string, zero padded
+        };
+        // Open addressing table over the strings
+        vector<Slot> slots_;
+
+        static Slot make_slot(const char *str, size_t length, uint32_t number) {
+            Slot slot;
+            slot.number = number;
+            slot.length = (uint32_t) length;
+            memset(slot.prefix, 0, PREFIX_BYTES);
+            memcpy(slot.prefix, str, length < PREFIX_BYTES ? length : PREFIX_BYTES);
+            return slot;
+        }
+
+        static size_t hash(const char *str, size_t length) {
+            // FNV-1a
+            uint64_t hash = 14695981039346656037ULL;
+            for(size_t i = 0; i < length; i++) {
+                hash = (hash ^ (unsigned char) str[i]) * 1099511628211ULL;
+            }
+            return (size_t) (hash ^ (hash >> 32));
+        }
+
+        void rebuild_slots(size_t count) {
+            vector<Slot> slots(count, make_slot("", 0, 0));
+            size_t mask = count - 1;
+            for(uint32_t number = 0; number < offset_.size(); number++) {
+                size_t slot = hash(data(number), length_[number]) & mask;
+                while(slots[slot].number != 0) {
+                    slot = (slot + 1) & mask;
+                }
+                slots[slot] = make_slot(data(number), length_[number], number + 1);
+            }
+            slots_.swap(slots);
+        }
+};
+
+/**
+ * Hash index from student ID to row numbers, covering rows 0 to count - 1 of
+ * the table. The table keeps the IDs, so the index itself is only an open
+ * addressing array of row + 1 (0 marking an empty slot). Rows are placed in
+ * row order, so rows sharing an ID sit along one probe run in row order and
+ * lookups return them that way.
+ */
+class IdIndex {
+    public:
+        IdIndex() : shift_{64}, count_{0} { }
+
+        void clear() {
+            slots_.clear();
+            shift_ = 64;
+            count_ = 0;
+        }
+
+        /**
+         * Replaces the index with the first rows entries of the ID column.
+         */
+        void build(const int id[], size_t rows) {
+            size_t count = 1024;
+            while(count < 2 * (rows + 1)) {
+                count *= 2;
+            }
+            count_ = rows;
+            rehash(id, count);
+        }
+
+        /**
+         * Adds the next row, whose ID is id[row]; id is the table's ID column.
+         */
+        void insert(const int id[], uint32_t row) {
+            // Keep the table at most half full
+            if(2 * (count_ + 1) > slots_.size()) {
+                rehash(id, slots_.empty() ? 1024 : 2 * slots_.size());
+            }
+            place(id[row], row);
+            count_++;
+        }
+
+        /**
+         * Appends the rows whose ID is key to rows.
+         */
+        void find(const int id[], int key, vector<uint32_t> &rows) const {
+            if(slots_.empty()) {
+                return;
+            }
+            size_t mask = slots_.size() - 1;
+            for(size_t slot = hash(key); slots_[slot] != 0; slot = (slot + 1) & mask) {
+                if(id[slots_[slot] - 1] == key) {
+                    rows.push_back(slots_[slot] - 1);
+                }
+            }
+        }
+
+    private:
+        vector<uint32_t> slots_;
+        int shift_;
+        size_t count_;
+
+        size_t hash(int key) const {
+            // Fibonacci hashing: the top bits of the product pick the slot
+            return (size_t) (((uint64_t) (uint32_t) key * 0x9E3779B97F4A7C15ULL) >> shift_);
+        }
+
+        void place(int key, uint32_t row) {
+            size_t mask = slots_.size() - 1;
+            size_t slot = hash(key);
+            while(slots_[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots_[slot] = row + 1;
+        }
+
+        void rehash(const int id[], size_t count) {
+            slots_.assign(count, 0);
+            shift_ = 64;
+            while(((size_t) 1 << (64 - shift_)) < count) {
+                shift_--;
+            }
+            for(size_t row = 0; row < count_; row++) {
+                place(id[row], (uint32_t) row);
+            }
+        }
+};
+
+/**
+ * Index of rows ranked by GPA, highest first, ties by row. Most entries sit in
+ * one sorted array; new ones go into a balanced tree that is merged into the
+ * array once it holds more than a sixteenth of the entries, so inserts cost
+ * O(log n) amortized and the index stays as compact as the array. Queries
+ * binary search the array and the tree and merge what they find.
+ */
+class GpaIndex {
+    public:
+        void clear() {
+            sorted_.clear();
+            recent_.clear();
+        }
+
+        /**
+         * Replaces the index with the first rows entries of the GPA column.
+         */
+        void build(const float gpa[], size_t rows) {
+            recent_.clear();
+            sorted_.resize(rows);
+            for(size_t row = 0; row < rows; row++) {
+                sorted_[row].gpa = gpa[row];
+                sorted_[row].row = (uint32_t) row;
+            }
+            sort(sorted_.begin(), sorted_.end(), Ranked());
+        }
+
+        void insert(float gpa, uint32_t row) {
+            Entry entry = {gpa, row};
+            recent_.insert(entry);
+            if(recent_.size() > MIN_RECENT && recent_.size() > sorted_.size() / 16) {
+                vector<Entry> merged(sorted_.size() + recent_.size());
+                merge(sorted_.begin(), sorted_.end(), recent_.begin(), recent_.end(),
+                      merged.begin(), Ranked());
+                sorted_.swap(merged);
+                recent_.clear();
+            }
+        }
+
+        /**
+         * Appends the rows whose GPA lies in [low, high) to rows, highest GPA
+         * first.
+         */
+        void range(float low, float high, vector<uint32_t> &rows) const {
+            // In ranked order the GPAs in [low, high) lie between the first
+            // entry below high and the first entry below low
+            Entry from = {high, numeric_limits<uint32_t>::max()};
+            Entry to = {low, numeric_limits<uint32_t>::max()};
+            merge_rows(upper_bound(sorted_.begin(), sorted_.end(), from, Ranked()),
+                       upper_bound(sorted_.begin(), sorted_.end(), to, Ranked()),
+                       recent_.upper_bound(from), recent_.upper_bound(to),
+                       numeric_limits<size_t>::max(), rows);
+        }
+
+        /**
+         * Appends the count rows with the highest GPAs to rows, highest first.
+         */
+        void top(size_t count, vector<uint32_t> &rows) const {
+            merge_rows(sorted_.begin(), sorted_.end(), recent_.begin(), recent_.end(),
+                       count, rows);
+        }
+
+    private:
+        struct Entry {
+            float gpa;
+            uint32_t row;
+        };
+
+        struct Ranked {
+            bool operator()(const Entry &a, const Entry &b) const {
+                return a.gpa > b.gpa || (a.gpa == b.gpa && a.row < b.row);
+            }
+        };
+
+        typedef vector<Entry>::const_iterator array_iterator;
+        typedef set<Entry, Ranked>::const_iterator tree_iterator;
+
+        // Below this many entries the tree is never merged
+        static const size_t MIN_RECENT = 1024;
+
+        vector<Entry> sorted_;
+        set<Entry, Ranked> recent_;
+
+        static void merge_rows(array_iterator a, array_iterator a_end, tree_iterator t,
+                               tree_iterator t_end, size_t count, vector<uint32_t> &rows) {
+            Ranked ranked;
+            for(; count > 0 && (a != a_end || t != t_end); count--) {
+                if(t == t_end || (a != a_end && ranked(*a, *t))) {
+                    rows.push_back((a++)->row);
+                } else {
+                    rows.push_back((t++)->row);
+                }
+            }
+        }
+};
+
+/**
+ * Column store for large rosters: one array per field instead of one object
+ * per student, so a scan over GPAs touches only the GPAs. The four columns
+ * (GPA, ID, first name number, last name number) share a single allocation,
+ * and the names themselves are interned in a NamePool.
+ *
+ * A hash index on ID and a ranked index on GPA are built the first time an
+ * indexed query runs and are kept up to date by add() from then on. Query
+ * results are cached, and the cache is dropped whenever the table's version
+ * (bumped by every change) moves on. Cached queries hand out shared,
+ * immutable results, so a hit copies no rows and a result stays valid after
+ * the cache lets go of it. Since even const queries fill the cache and
+ * indexes, a table must not be queried from several threads at once.
+ */
+class StudentTable {
+    public:
+        typedef uint32_t row_t;
+        typedef vector<row_t> selection_t;
+        typedef shared_ptr<const selection_t> shared_selection_t;
+
+        StudentTable() : size_{0}, capacity_{0}, gpa_{nullptr}, id_{nullptr},
+                         first_{nullptr}, last_{nullptr}, version_{0}, indexed_{false},
+                         cache_version_{0} { }
+
+        size_t size() const {
+            return size_;
+        }
+
+        /**
+         * Makes room for the given number of rows in one allocation.
+         */
+        void reserve(size_t rows) {
+            if(rows <= capacity_) {
+                return;
+            }
+            unique_ptr<char[]> block(new char[rows * ROW_BYTES]);
+            float *gpa = (float *) block.get();
+            int *id = (int *) (gpa + rows);
+            uint32_t *first = (uint32_t *) (id + rows);
+            uint32_t *last = first + rows;
+            if(size_ > 0) {
+                memcpy(gpa, gpa_, size_ * sizeof(float));
+                memcpy(id, id_, size_ * sizeof(int));
+                memcpy(first, first_, size_ * sizeof(uint32_t));
+                memcpy(last, last_, size_ * sizeof(uint32_t));
+            }
+            block_.swap(block);
+            capacity_ = rows;
+            gpa_ = gpa;
+            id_ = id;
+            first_ = first;
+            last_ = last;
+        }
+
+        /**
+         * Appends a student and returns its row number.
+         */
+        row_t add(const string &first, const string &last, float gpa, int id) {
+            if(size_ == capacity_) {
+                reserve(capacity_ < 16 ? 16 : 2 * capacity_);
+            }
+            row_t row = (row_t) size_++;
+            gpa_[row] = gpa;
+            id_[row] = id;
+            first_[row] = names_.intern(first.data(), first.size());
+            last_[row] = names_.intern(last.data(), last.size());
+            version_++;
+            if(indexed_) {
+                by_id_.insert(id_, row);
+                by_gpa_.insert(gpa, row);
+            }
+            return row;
+        }
+
+        /**
+         * Counter bumped by every change to the table.
+         */
+        uint64_t version() const {
+            return version_;
+        }
+
+        float gpa(row_t row) const {
+            return gpa_[row];
+        }
+
+        int id(row_t row) const {
+            return id_[row];
+        }
+
+        const float* gpa_column() const {
+            return gpa_;
+        }
+
+        const int* id_column() const {
+            return id_;
+        }
+
+        string first_name(row_t row) const {
+            return names_.name(first_[row]);
+        }
+
+        string last_name(row_t row) const {
+            return names_.name(last_[row]);
+        }
+
+        string full_name(row_t row) const {
+            return first_name(row) + " " + last_name(row);
+        }
+
+        /**
+         * Number of distinct first and last names stored in the arena.
+         */
+        size_t distinct_names() const {
+            return names_.size();
+        }
+
+        /**
+         * Prints a row in the same format as Student::print_info(), writing the
+         * names straight from the arena.
+         */
+        void print_info(row_t row) const {
+            names_.write(first_[row]);
+            cout << ' ';
+            names_.write(last_[row]);
+            cout << ", GPA: " << fixed << setprecision(2) << gpa_[row] << ", ID: " << id_[row];
+        }
+
+        /**
+         * Returns, in increasing order, the rows whose GPA lies in [low, high).
+         * Scans the whole column, comparing 8 GPAs per instruction with AVX2
+         * and 4 with SSE2; the result is cached.
+         */
+        shared_selection_t select_gpa(float low, float high) const {
+            return cached(make_key(SCAN_GPA, low, high, 0), [&]() {
+                return scan_gpa(low, high);
+            });
+        }
+
+        /**
+         * Returns the rows whose GPA is below threshold.
+         */
+        shared_selection_t select_gpa_below(float threshold) const {
+            return select_gpa(-numeric_limits<float>::infinity(), threshold);
+        }
+
+        /**
+         * Returns, in increasing order, the rows with the given ID, in
+         * expected constant time.
+         */
+        selection_t find_id(int id) const {
+            ensure_indexes();
+            selection_t rows;
+            by_id_.find(id_, id, rows);
+            return rows;
+        }
+
+        /**
+         * Returns the rows whose GPA lies in [low, high), highest GPA first
+         * and ties in row order, in O(log n) time plus the size of the result.
+         */
+        shared_selection_t gpa_range(float low, float high) const {
+            return cached(make_key(GPA_RANGE, low, high, 0), [&]() {
+                ensure_indexes();
+                selection_t rows;
+                by_gpa_.range(low, high, rows);
+                return rows;
+            });
+        }
+
+        /**
+         * Returns the count rows with the highest GPAs, highest first and ties
+         * in row order.
+         */
+        shared_selection_t top_gpa(size_t count) const {
+            return cached(make_key(TOP_GPA, 0, 0, count), [&]() {
+                ensure_indexes();
+                selection_t rows;
+                by_gpa_.top(count, rows);
+                return rows;
+            });
+        }
+
+        friend int load_binary(const char *path, const char *data, size_t size,
+                               StudentTable &table);
+        friend int load_csv(const char *path, const char *data, size_t size,
+                            StudentTable &table, unsigned num_threads);
+        friend bool save_students(const char *path, const StudentTable &table);
+
+    private:
+        enum query_t { SCAN_GPA, GPA_RANGE, TOP_GPA };
+
+        /**
+         * Identifies a query in the cache. The GPA bounds are kept as bit
+         * patterns so that a NaN bound cannot upset the ordering.
+         */
+        struct QueryKey {
+            query_t kind;
+            uint32_t low;
+            uint32_t high;
+            uint64_t count;
+
+            bool operator<(const QueryKey &rhs) const {
+                return tie(kind, low, high, count) < tie(rhs.kind, rhs.low, rhs.high, rhs.count);
+            }
+        };
+
+        // The cache is emptied rather than grown past this many results
+        static const size_t QUERY_CACHE_SIZE = 64;
+        static const size_t ROW_BYTES = sizeof(float) + sizeof(int) + 2 * sizeof(uint32_t);
+
+        NamePool names_;
+        size_t size_;
+        size_t capacity_;
+        unique_ptr<char[]> block_;
+        // Columns, each capacity_ entries long, carved out of block_
+        float *gpa_;
+        int *id_;
+        uint32_t *first_;
+        uint32_t *last_;
+
+        uint64_t version_;
+        mutable bool indexed_;
+        mutable IdIndex by_id_;
+        mutable GpaIndex by_gpa_;
+        mutable map<QueryKey, shared_selection_t> query_cache_;
+        mutable uint64_t cache_version_;
+
+        static QueryKey make_key(query_t kind, float low, float high, uint64_t count) {
+            QueryKey key;
+            key.kind = kind;
+            memcpy(&key.low, &low, sizeof(key.low));
+            memcpy(&key.high, &high, sizeof(key.high));
+            key.count = count;
+            return key;
+        }
+
+        /**
+         * Returns the cached result of the query, running it first if it is
+         * not cached for the current version of the table.
+         */
+        template <typename Query>
+        shared_selection_t cached(const QueryKey &key, Query query) const {
+            if(cache_version_ != version_) {
+                query_cache_.clear();
+                cache_version_ = version_;
+            }
+            map<QueryKey, shared_selection_t>::const_iterator found = query_cache_.find(key);
+            if(found != query_cache_.end()) {
+                return found->second;
+            }
+            if(query_cache_.size() >= QUERY_CACHE_SIZE) {
+                query_cache_.clear();
+            }
+            // The result is moved into shared storage, not copied
+            shared_selection_t result = make_shared<selection_t>(query());
+            query_cache_[key] = result;
+            return result;
+        }
+
+        void ensure_indexes() const {
+            if(!indexed_) {
+                by_id_.build(id_, size_);
+                by_gpa_.build(gpa_, size_);
+                indexed_ = true;
+            }
+        }
+
+        selection_t scan_gpa(float low, float high) const {
+            selection_t rows;
+            const float *gpa = gpa_;
+            const size_t n = size_;
+            size_t i = 0;
+#if defined(__AVX2__)
+            const __m256 lo = _mm256_set1_ps(low), hi = _mm256_set1_ps(high);
+            for(; i + 8 <= n; i += 8) {
+                __m256 value = _mm256_loadu_ps(gpa + i);
+                unsigned mask = (unsigned) _mm256_movemask_ps(_mm256_and_ps(
+                    _mm256_cmp_ps(value, lo, _CMP_GE_OQ), _mm256_cmp_ps(value, hi, _CMP_LT_OQ)));
+                append_rows(rows, (row_t) i, mask);
+            }
+#elif defined(__SSE2__)
+            const __m128 lo = _mm_set1_ps(low), hi = _mm_set1_ps(high);
+            for(; i + 4 <= n; i += 4) {
+                __m128 value = _mm_loadu_ps(gpa + i);
+                unsigned mask = (unsigned) _mm_movemask_ps(_mm_and_ps(
+                    _mm_cmpge_ps(value, lo), _mm_cmplt_ps(value, hi)));
+                append_rows(rows, (row_t) i, mask);
+            }
+#endif
+            for(; i < n; i++) {
+                if(gpa[i] >= low && gpa[i] < high) {
+                    rows.push_back((row_t) i);
+                }
+            }
+            return rows;
+        }
+
+        static void append_rows(selection_t &rows, row_t base, unsigned mask) {
+            while(mask) {
+                rows.push_back(base + (row_t) __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+};
+
+/**
+* Returns the rows of the table whose GPA is < 1.0, without copying any
+* student data.
+*/
+StudentTable::shared_selection_t find_failing_students(const StudentTable &table) {
+    return table.select_gpa_below(1.0f);
+}
+
+/**
+* Prints the given rows of the table to the screen.
+*/
+void print_students(const StudentTable &table, const StudentTable::selection_t &rows) {
+    for(size_t i = 0; i < rows.size(); i++) {
+        table.print_info(rows[i]);
+        cout << "\n";
+    }
+}
+
+/**
+* Prints every row of the table to the screen.
+*/
+void print_students(const StudentTable &table) {
+    for(StudentTable::row_t row = 0; row < table.size(); row++) {
+        table.print_info(row);
+        cout << "\n";
+    }
+}
+
+
+// Files smaller than this many bytes per thread are parsed by fewer threads.
+const size_t MIN_CHUNK_BYTES = 1 << 20;
+// First eight bytes of a file written by save_students().
+const char BINARY_MAGIC[8] = {'S', 'T', 'U', 'D', 'T', 'B', 'L', '1'};
+
+/**
+ * Parses a GPA such as "3.25" from [begin, end). Short values are converted
+ * exactly with one float division (the mantissa and the power of ten are
+ * both exact floats), anything longer goes through strtof().
+ */
+bool parse_gpa(const char *begin, const char *end, float &value) {
+    static const float POWERS_OF_TEN[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                          1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    uint32_t mantissa = 0;
+    int digits = 0, fraction_digits = -1;
+    for(const char *p = begin; p < end; p++) {
+        if(*p == '.' && fraction_digits < 0) {
+            fraction_digits = 0;
+        } else if(*p >= '0' && *p <= '9') {
+            if(digits < 9) {
+                mantissa = mantissa * 10 + (uint32_t) (*p - '0');
+            }
+            digits++;
+            fraction_digits += fraction_digits >= 0;
+        } else {
+            return false;
+        }
+    }
+    if(digits == 0) {
+        return false;
+    }
+    if(fraction_digits < 0) {
+        fraction_digits = 0;
+    }
+    if(digits <= 7 && fraction_digits <= 10) {
+        value = (float) mantissa / POWERS_OF_TEN[fraction_digits];
+        return true;
+    }
+    char buffer[64];
+    if(end - begin >= (ptrdiff_t) sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, begin, end - begin);
+    buffer[end - begin] = '\0';
+    value = strtof(buffer, nullptr);
+    return true;
+}
+
+/**
+ * Parses a decimal int, optionally negative, from [begin, end).
+ */
+bool parse_id(const char *begin, const char *end, int &value) {
+    bool negative = begin < end && *begin == '-';
+    begin += negative;
+    if(begin == end) {
+        return false;
+    }
+    long long result = 0;
+    for(const char *p = begin; p < end; p++) {
+        if(*p < '0' || *p > '9') {
+            return false;
+        }
+        result = result * 10 + (*p - '0');
+        if(result > (long long) numeric_limits<int>::max() + 1) {
+            return false;
+        }
+    }
+    result = negative ? -result : result;
+    if(result > numeric_limits<int>::max()) {
+        return false;
+    }
+    value = (int) result;
+    return true;
+}
+
+/**
+ * Splits the CSV line [begin, end) at its commas. Returns false unless it
+ * has exactly four fields.
+ */
+bool split_fields(const char *begin, const char *end, const char *fields[5]) {
+    int count = 1;
+    fields[0] = begin;
+    for(const char *p = begin; p < end; p++) {
+        if(*p == ',') {
+            if(count == 4) {
+                return false;
+            }
+            fields[count++] = p + 1;
+        }
+    }
+    // fields[k + 1] - 1 is the end of field k
+    fields[4] = end + 1;
+    return count == 4;
+}
+
+/**
+ * Parses the lines of [begin, end) into the given column slices, numbering
+ * names in the chunk's own pool. Blank lines are skipped. Returns the number
+ * of rows written, or sets bad_line to the 0-based index of the first
+ * malformed line within the chunk and returns 0.
+ */
+size_t parse_chunk(const char *begin, const char *end, float gpa[], int id[],
+                   uint32_t first[], uint32_t last[], NamePool &names, size_t &bad_line) {
+    size_t rows = 0;
+    const char *fields[5];
+    for(size_t line = 0; begin < end; line++) {
+        const char *newline = (const char *) memchr(begin, '\n', end - begin);
+        const char *line_end = newline ? newline : end;
+        const char *next = newline ? newline + 1 : end;
+        if(line_end > begin && line_end[-1] == '\r') {
+            line_end--;
+        }
+        if(line_end == begin) {
+            begin = next;
+            continue;
+        }
+
+        float value;
+        if(!split_fields(begin, line_end, fields) ||
+           fields[1] - 1 == fields[0] || fields[2] - 1 == fields[1] ||
+           !parse_gpa(fields[2], fields[3] - 1, value) || value < 0 || value > 4 ||
+           !parse_id(fields[3], fields[4] - 1, id[rows])) {
+            bad_line = line;
+            return 0;
+        }
+        gpa[rows] = value;
+        first[rows] = names.intern(fields[0], fields[1] - 1 - fields[0]);
+        last[rows] = names.intern(fields[1], fields[2] - 1 - fields[1]);
+        rows++;
+        begin = next;
+    }
+    return rows;
+}
+
+/**
+ * Loads a binary file written by save_students().
+ */
+int load_binary(const char *path, const char *data, size_t size, StudentTable &table) {
+    const size_t HEADER_BYTES = sizeof(BINARY_MAGIC) + 3 * sizeof(uint64_t);
+    uint64_t counts[3] = {0, 0, 0};
+    if(size >= HEADER_BYTES) {
+        memcpy(counts, data + sizeof(BINARY_MAGIC), sizeof(counts));
+    }
+    const uint64_t rows = counts[0], names = counts[1], arena_bytes = counts[2];
+    // Bounds chosen so that none of the sizes below can overflow
+    if(size < HEADER_BYTES || rows > numeric_limits<uint32_t>::max() ||
+       names > numeric_limits<uint32_t>::max() || arena_bytes > size ||
+       HEADER_BYTES + rows * StudentTable::ROW_BYTES + names * 2 * sizeof(uint32_t) +
+       arena_bytes != size) {
+        cerr << "Error: File '" << path << "' is not a valid student table." << endl;
+        return 1;
+    }
+
+    // The columns are stored back to back, exactly as in a block of capacity rows
+    const char *columns = data + HEADER_BYTES;
+    const uint32_t *offsets = (const uint32_t *) (columns + rows * StudentTable::ROW_BYTES);
+    const uint32_t *lengths = offsets + names;
+    const char *arena = (const char *) (lengths + names);
+    StudentTable loaded;
+    loaded.reserve(rows);
+    memcpy(loaded.block_.get(), columns, rows * StudentTable::ROW_BYTES);
+    loaded.size_ = rows;
+    bool valid = loaded.names_.load(offsets, lengths, names, arena, arena_bytes);
+    for(size_t row = 0; valid && row < rows; row++) {
+        valid = loaded.first_[row] < names && loaded.last_[row] < names;
+    }
+    if(!valid) {
+        cerr << "Error: File '" << path << "' is not a valid student table." << endl;
+        return 1;
+    }
+    swap(table, loaded);
+    return 0;
+}
+
+/**
+ * Loads CSV text; see load_students().
+ */
+int load_csv(const char *path, const char *data, size_t size, StudentTable &table,
+             unsigned num_threads) {
+    // Skip a header line. A record with only a bad GPA or only a bad ID is
+    // reported as invalid rather than taken for a header.
+    size_t start = 0, header_lines = 0;
+    if(size > 0) {
+        const char *newline = (const char *) memchr(data, '\n', size);
+        size_t line_end = newline ? newline - data : size;
+        size_t field_end = (line_end > 0 && data[line_end - 1] == '\r') ? line_end - 1 : line_end;
+        const char *fields[5];
+        float value;
+        int id;
+        if(split_fields(data, data + field_end, fields) &&
+           !parse_gpa(fields[2], fields[3] - 1, value) &&
+           !parse_id(fields[3], fields[4] - 1, id)) {
+            start = newline ? line_end + 1 : size;
+            header_lines = 1;
+        }
+    }
+    if(start == size) {
+        // Empty, or only a header: nothing to parse
+        StudentTable empty;
+        swap(table, empty);
+        return 0;
+    }
+
+    // Chunk boundaries, each moved forward to just past a newline
+    size_t num_chunks = min<size_t>(num_threads, (size - start) / MIN_CHUNK_BYTES + 1);
+    vector<size_t> bounds(1, start);
+    for(size_t c = 1; c < num_chunks; c++) {
+        size_t next = max(bounds.back(), start + (size - start) / num_chunks * c);
+        const char *newline = next < size ? (const char *) memchr(data + next, '\n', size - next)
+                                          : nullptr;
+        bounds.push_back(newline ? newline - data + 1 : size);
+    }
+    bounds.push_back(size);
+
+    // Pass 1: lines per chunk, an upper bound on its rows
+    vector<size_t> lines(num_chunks, 0);
+    auto run_parallel = [&](const function<void(size_t)> &task) {
+        vector<thread> threads;
+        for(size_t c = 1; c < num_chunks; c++) {
+            threads.push_back(thread(task, c));
+        }
+        task(0);
+        for(size_t i = 0; i < threads.size(); i++) {
+            threads[i].join();
+        }
+    };
+    run_parallel([&](size_t c) {
+        const char *p = data + bounds[c], *end = data + bounds[c + 1];
+        size_t count = 0;
+        while((p = (const char *) memchr(p, '\n', end - p)) != nullptr) {
+            count++;
+            p++;
+        }
+        // A last line without a newline
+        lines[c] = count + (end > data + bounds[c] && end[-1] != '\n');
+    });
+    vector<size_t> first_row(num_chunks + 1, 0);
+    for(size_t c = 0; c < num_chunks; c++) {
+        first_row[c + 1] = first_row[c] + lines[c];
+    }
+    if(first_row[num_chunks] > numeric_limits<StudentTable::row_t>::max()) {
+        cerr << "Error: File '" << path << "' has too many records." << endl;
+        return 1;
+    }
+
+    // Pass 2: parse every chunk into its slice with a private name pool
+    StudentTable loaded;
+    loaded.reserve(first_row[num_chunks]);
+    vector<NamePool> pools(num_chunks);
+    vector<size_t> rows(num_chunks, 0);
+    vector<size_t> bad_line(num_chunks, numeric_limits<size_t>::max());
+    run_parallel([&](size_t c) {
+        size_t r = first_row[c];
+        rows[c] = parse_chunk(data + bounds[c], data + bounds[c + 1], loaded.gpa_ + r,
+                              loaded.id_ + r, loaded.first_ + r, loaded.last_ + r,
+                              pools[c], bad_line[c]);
+    });
+    size_t line_number = header_lines + 1;
+    for(size_t c = 0; c < num_chunks; c++) {
+        if(bad_line[c] != numeric_limits<size_t>::max()) {
+            cerr << "Error: Invalid record on line " << line_number + bad_line[c]
+                 << " of '" << path << "'." << endl;
+            return 1;
+        }
+        line_number += lines[c];
+    }
+
+    // Merge the pools: each distinct name is interned into the table once
+    vector< vector<uint32_t> > renumber(num_chunks);
+    for(size_t c = 0; c < num_chunks; c++) {
+        renumber[c].resize(pools[c].size());
+        for(uint32_t k = 0; k < renumber[c].size(); k++) {
+            renumber[c][k] = loaded.names_.intern(pools[c].data(k), pools[c].length(k));
+        }
+        pools[c] = NamePool();
+    }
+    run_parallel([&](size_t c) {
+        for(size_t r = first_row[c]; r < first_row[c] + rows[c]; r++) {
+            loaded.first_[r] = renumber[c][loaded.first_[r]];
+            loaded.last_[r] = renumber[c][loaded.last_[r]];
+        }
+    });
+
+    // Close up the gaps left by blank lines
+    size_t size_rows = 0;
+    for(size_t c = 0; c < num_chunks; c++) {
+        size_t from = first_row[c];
+        if(from != size_rows) {
+            memmove(loaded.gpa_ + size_rows, loaded.gpa_ + from, rows[c] * sizeof(float));
+            memmove(loaded.id_ + size_rows, loaded.id_ + from, rows[c] * sizeof(int));
+            memmove(loaded.first_ + size_rows, loaded.first_ + from, rows[c] * sizeof(uint32_t));
+            memmove(loaded.last_ + size_rows, loaded.last_ + from, rows[c] * sizeof(uint32_t));
+        }
+        size_rows += rows[c];
+    }
+    loaded.size_ = size_rows;
+    swap(table, loaded);
+    return 0;
+}
+
+/**
+ * Writes the table in the binary format read by load_students(): the magic
+ * bytes, the row, name and arena byte counts as 64-bit integers, the four
+ * columns and then the name pool. Returns false if the file cannot be
+ * written.
+ */
+bool save_students(const char *path, const StudentTable &table) {
+    FILE *file = fopen(path, "wb");
+    if(!file) {
+        return false;
+    }
+    uint64_t counts[3] = {table.size_, table.names_.size(), table.names_.arena_bytes()};
+    fwrite(BINARY_MAGIC, 1, sizeof(BINARY_MAGIC), file);
+    fwrite(counts, sizeof(uint64_t), 3, file);
+    fwrite(table.gpa_, sizeof(float), table.size_, file);
+    fwrite(table.id_, sizeof(int), table.size_, file);
+    fwrite(table.first_, sizeof(uint32_t), table.size_, file);
+    fwrite(table.last_, sizeof(uint32_t), table.size_, file);
+    table.names_.save(file);
+    bool written = !ferror(file);
+    return fclose(file) == 0 && written;
+}
+
+/**
+ * Loads the students in a file into table, replacing its contents. The file
+ * is either a binary table written by save_students() or CSV text with one
+ * "first,last,gpa,id" record per line (no quoting; blank lines are skipped,
+ * and a first line whose GPA and ID fields are both not numbers is taken as a
+ * header).
+ *
+ * The CSV text is memory mapped and cut into one chunk per thread at line
+ * boundaries. A first pass counts each chunk's lines, which bounds its rows,
+ * so the table is allocated once and every thread parses straight into its
+ * own slice of the columns, interning names into a private pool. The pools
+ * are then merged: each distinct name is interned once into the table, and
+ * the chunk's name numbers are rewritten to match. Slices left short by
+ * blank lines are closed up at the end. Returns 0 on success and 1 (after
+ * printing an error) otherwise.
+ */
+int load_students(const char *path, StudentTable &table, unsigned num_threads) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        cerr << "Error: Cannot open file '" << path << "'." << endl;
+        if(fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    size_t size = st.st_size;
+    const char *data = nullptr;
+    if(size > 0) {
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED) {
+            cerr << "Error: Cannot map file '" << path << "'." << endl;
+            close(fd);
+            return 1;
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = (const char *) mapped;
+    }
+    close(fd);
+
+    int status = 0;
+    if(size >= sizeof(BINARY_MAGIC) && memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0) {
+        status = load_binary(path, data, size, table);
+    } else {
+        status = load_csv(path, data, size, table, num_threads);
+    }
+    if(size > 0) {
+        munmap((void *) data, size);
+    }
+    return status;
+}
+
+/**
+* Prints all students and then the failing ones, or " None" on the
+* "Failing students:" line if there are none.
+*/
+void print_report(const vector<Student> &students) {
+    cout << endl << "All students:" << endl;
+    print_students(students);
+    cout << endl << "Failing students:";
+
+    // Print a space and the word 'None' on the same line if no students are failing.
+    // Otherwise, print each failing student on a separate line.
+
+    student_view_t failing_students = find_failing_students(students);
+    if(failing_students.size() == 0) {
+        cout << " None";
+    } else {
+        cout << "\n";
+        print_students(failing_students);
+    }
+}
+
+/**
+* Same report as above for a table loaded from a file.
+*/
+void print_report(const StudentTable &students) {
+    cout << endl << "All students:" << endl;
+    print_students(students);
+    cout << endl << "Failing students:";
+
+    StudentTable::shared_selection_t failing_students = find_failing_students(students);
+    if(failing_students->size() == 0) {
+        cout << " None";
+    } else {
+        cout << "\n";
+        print_students(students, *failing_students);
+    }
+}
+
+/**
+* Reports on cerr if a query returned other rows than the reference.
+* Returns true if they agree.
+*/
+bool check_rows(const string &query, const StudentTable::selection_t &expected,
+                const StudentTable::selection_t &actual) {
+    if(expected != actual) {
+        cerr << "Error: " << query << " returned " << actual.size() << " rows; expected "
+             << expected.size() << "." << endl;
+        return false;
+    }
+    return true;
+}
 
 /**
-* Allows the user to enter information for multiple students, then
-* find those students whose GPA is below 1.0 and prints them to the
-* screen. */
-int main() {
+* Cross-checks the table's queries (find_id, gpa_range, top_gpa and
+* select_gpa) against brute-force scans on a random table of the given size,
+* with repeated IDs and GPAs. Runs once before and once after appending more
+* rows to the indexed table, and checks that an earlier result survives the
+* cache being cleared and the table changing. Returns true if all agree.
+*/
+bool check_student_table(size_t rows) {
+    mt19937 rng((unsigned) rows);
+    StudentTable table;
+    auto add_rows = [&](size_t count) {
+        for(size_t i = 0; i < count; i++) {
+            table.add("First" + to_string(rng() % 100), "Last" + to_string(rng() % 100),
+                      (rng() % 401) / 100.0f, (int) (rng() % (rows / 2 + 1)));
+        }
+    };
+    // All rows ranked as the GPA index ranks them: highest GPA first, ties
+    // in row order
+    auto ranked = [&](float low, float high) {
+        StudentTable::selection_t result;
+        for(StudentTable::row_t row = 0; row < table.size(); row++) {
+            if(table.gpa(row) >= low && table.gpa(row) < high) {
+                result.push_back(row);
+            }
+        }
+        stable_sort(result.begin(), result.end(), [&](StudentTable::row_t a, StudentTable::row_t b) {
+            return table.gpa(a) > table.gpa(b);
+        });
+        return result;
+    };
+
+    bool ok = true;
+    add_rows(rows);
+    StudentTable::shared_selection_t held = table.gpa_range(1.0f, 2.0f);
+    StudentTable::selection_t held_expected = ranked(1.0f, 2.0f);
+    for(int pass = 0; pass < 2; pass++) {
+        for(int i = 0; i < 100; i++) {
+            float low = (rng() % 401) / 100.0f, high = low + (rng() % 100) / 100.0f;
+            StudentTable::selection_t expected = ranked(low, high);
+            ok &= check_rows("gpa_range", expected, *table.gpa_range(low, high));
+            sort(expected.begin(), expected.end());
+            ok &= check_rows("select_gpa", expected, *table.select_gpa(low, high));
+
+            size_t count = rng() % (table.size() + 2);
+            StudentTable::selection_t top = ranked(-numeric_limits<float>::infinity(),
+                                                   numeric_limits<float>::infinity());
+            top.resize(min(count, top.size()));
+            ok &= check_rows("top_gpa", top, *table.top_gpa(count));
+
+            int id = (int) (rng() % (rows / 2 + 2));
+            StudentTable::selection_t with_id;
+            for(StudentTable::row_t row = 0; row < table.size(); row++) {
+                if(table.id(row) == id) {
+                    with_id.push_back(row);
+                }
+            }
+            ok &= check_rows("find_id", with_id, table.find_id(id));
+        }
+        // More rows go through the indexes' incremental inserts
+        add_rows(rows / 4 + 1);
+    }
+    ok &= check_rows("an earlier gpa_range", held_expected, *held);
+    return ok;
+}
+
+/**
+* Allows the user to enter information for multiple students, or loads them
+* from a CSV or binary file with --load, then find those students whose GPA
+* is below 1.0 and prints them to the screen. With --save, the loaded
+* students are written to a binary file instead. Entered students are kept
+* as Student objects; files go into a StudentTable, which handles millions
+* of rows. */
+int main(int argc, char *argv[]) {
+    if(argc == 3 && string(argv[1]) == "--check") {
+        size_t rows;
+        istringstream rows_iss(argv[2]);
+        if(!(rows_iss >> rows) || rows == 0 || argv[2][0] == '-') {
+            cerr << "Error: Invalid number of rows '" << argv[2] << "'." << endl;
+            return 1;
+        }
+        if(!check_student_table(rows)) {
+            return 1;
+        }
+        cout << "StudentTable queries agree on " << rows << " rows." << endl;
+        return 0;
+    }
+
+    if(argc > 1) {
+        StudentTable students;
+        const char *output = nullptr;
+        unsigned num_threads = max(1u, thread::hardware_concurrency());
+        bool valid = argc >= 3 && string(argv[1]) == "--load";
+        for(int i = 3; valid && i < argc; i++) {
+            string option = argv[i];
+            int threads;
+            if(option == "--save" && i + 1 < argc) {
+                output = argv[++i];
+            } else if(option == "--threads" && i + 1 < argc &&
+                      (istringstream(argv[i + 1]) >> threads) && threads > 0) {
+                num_threads = threads;
+                i++;
+            } else {
+                valid = false;
+            }
+        }
+        if(!valid) {
+            cerr << "Usage: " << argv[0] << " [--load <file> [--threads <n>] [--save <file>]]" << endl
+                 << "       " << argv[0] << " --check <rows>" << endl;
+            return 1;
+        }
+        if(load_students(argv[2], students, num_threads) != 0) {
+            return 1;
+        }
+        if(output) {
+            if(!save_students(output, students)) {
+                cerr << "Error: Cannot write file '" << output << "'." << endl;
+                return 1;
+            }
+            return 0;
+        }
+        print_report(students);
+        return 0;
+    }
+
     string first_name, last_name;
     float gpa;
     int id;
@@ -91,23 +1347,12 @@ int main() {
         }
         cout << "Enter student's ID: ";
         cin >> id;
-        students.push_back(Student(first_name, last_name, gpa, id));
+        // The names are moved into the new Student; cin refills them next time
+        students.emplace_back(std::move(first_name), std::move(last_name), gpa, id);
         cout << "Add another student to database (Y/N)? ";
         cin >> repeat;
     } while (repeat == 'Y' || repeat == 'y');
-    cout << endl << "All students:" << endl;
-    print_students(students);
-    cout << endl << "Failing students:";
-
-    // Print a space and the word 'None' on the same line if no students are failing.
-    // Otherwise, print each failing student on a separate line.
-
-    if(find_failing_students(students).size() == 0) {
-        cout << " None";
-    } else {
-        cout << "\n";
-        print_students(find_failing_students(students));
-    }
+    print_report(students);
 
     return 0;
 }
\ No newline at end of file
@@ -6,6 +6,14 @@
 #include <sstream>
 #include <algorithm>
 #include <vector>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <functional>
+#include <stdexcept>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
@@ -27,28 +35,793 @@ size_t lomuto_partition(int array[], size_t left, size_t right) {
     return s;
 }
 
+// Subarrays at most this long are finished off with insertion sort.
+const size_t INSERTION_SORT_THRESHOLD = 16;
+// Subarrays longer than this use a ninther instead of a median of 3 as pivot.
+const size_t NINTHER_THRESHOLD = 128;
+
+/**
+ * Sorts array[left..right] in place with insertion sort.
+ */
+void insertion_sort(int array[], size_t left, size_t right) {
+    for(size_t i = left + 1; i <= right; i++) {
+        int value = array[i];
+        size_t j = i;
+        while(j > left && value < array[j - 1]) {
+            array[j] = array[j - 1];
+            j--;
+        }
+        array[j] = value;
+    }
+}
+
+/**
+ * Returns the median of the three values at indexes a, b, and c.
+ */
+int median_of_3(const int array[], size_t a, size_t b, size_t c) {
+    int x = array[a], y = array[b], z = array[c];
+    if(x < y) {
+        return (y < z) ? y : ((x < z) ? z : x);
+    } else {
+        return (x < z) ? x : ((y < z) ? z : y);
+    }
+}
+
+/**
+ * Picks a pivot value for array[left..right]: the median of the first, middle,
+ * and last elements, or Tukey's ninther (median of three medians of 3) for
+ * larger subarrays. Sorted and reverse-sorted input then partitions evenly.
+ */
+int choose_pivot(const int array[], size_t left, size_t right) {
+    size_t length = right - left + 1;
+    size_t mid = left + length / 2;
+    if(length <= NINTHER_THRESHOLD) {
+        return median_of_3(array, left, mid, right);
+    }
+    size_t step = length / 8;
+    int a = median_of_3(array, left, left + step, left + 2 * step);
+    int b = median_of_3(array, mid - step, mid, mid + step);
+    int c = median_of_3(array, right - 2 * step, right - step, right);
+    return (a < b) ? ((b < c) ? b : ((a < c) ? c : a))
+                   : ((a < c) ? a : ((b < c) ? c : b));
+}
+
+/**
+ * Three-way (Dutch national flag) partition of array[left..right] around
+ * pivot. On return, array[left..lt-1] < pivot, array[lt..gt] == pivot, and
+ * array[gt+1..right] > pivot. Runs of equal keys are settled in one pass, so
+ * duplicate-heavy input does not degrade to quadratic time.
+ */
+void three_way_partition(int array[], size_t left, size_t right, int pivot,
+                         size_t &lt, size_t &gt) {
+    size_t i = left;
+    lt = left;
+    gt = right + 1;
+    while(i < gt) {
+        if(array[i] < pivot) {
+            swap(array[lt++], array[i++]);
+        } else if(array[i] > pivot) {
+            swap(array[i], array[--gt]);
+        } else {
+            i++;
+        }
+    }
+    gt--;
+}
+
+/**
+ * Returns how many pivot rounds a selection over length elements may take
+ * before it falls back to median of medians: twice the depth of a balanced
+ * split.
+ */
+size_t partition_round_limit(size_t length) {
+    size_t rounds = 0;
+    for(; length > 0; length /= 2) {
+        rounds += 2;
+    }
+    return rounds;
+}
+
+int median_of_medians_select(int array[], size_t left, size_t right, size_t k);
+
+/**
+ * Returns the median of medians of groups of 5 in array[left..right], moving
+ * the group medians to the front of the subarray along the way.
+ */
+int median_of_medians(int array[], size_t left, size_t right) {
+    size_t num_medians = 0;
+    for(size_t group = left; group <= right; group += 5) {
+        size_t group_right = min(group + 4, right);
+        insertion_sort(array, group, group_right);
+        swap(array[left + num_medians], array[group + (group_right - group) / 2]);
+        num_medians++;
+    }
+    return median_of_medians_select(array, left, left + num_medians - 1,
+                                    left + (num_medians + 1) / 2);
+}
+
+/**
+ * Selection with the median-of-medians pivot, which guarantees linear
+ * worst-case time. k follows the same convention as quick_select().
+ */
+int median_of_medians_select(int array[], size_t left, size_t right, size_t k) {
+    while(right - left >= INSERTION_SORT_THRESHOLD) {
+        int pivot = median_of_medians(array, left, right);
+        size_t lt, gt;
+        three_way_partition(array, left, right, pivot, lt, gt);
+        if(k - 1 < lt) {
+            right = lt - 1;
+        } else if(k - 1 > gt) {
+            left = gt + 1;
+        } else {
+            return pivot;
+        }
+    }
+    insertion_sort(array, left, right);
+    return array[k - 1];
+}
+
 int quick_select(int array[], size_t left, size_t right, size_t k) {
     // TODO
     // DO NOT change the function header in any way, otherwise you will lose points.
-    
-    size_t s = lomuto_partition(array, left, right);
-    
-    if(s == k - 1) {
-        return array[s];
-    } else if(s > k - 1) {
-        return quick_select(array, left, s - 1, k);
-    } else {
-        return quick_select(array, s + 1, right, k);
+
+    // Introselect: median-of-3/ninther pivots with a three-way partition,
+    // looping on the side that holds the k-th smallest element instead of
+    // recursing. If the partitions stop shrinking, fall back to median of
+    // medians.
+    size_t rounds_left = partition_round_limit(right - left + 1);
+
+    while(right - left >= INSERTION_SORT_THRESHOLD) {
+        if(rounds_left == 0) {
+            return median_of_medians_select(array, left, right, k);
+        }
+        rounds_left--;
+
+        int pivot = choose_pivot(array, left, right);
+        size_t lt, gt;
+        three_way_partition(array, left, right, pivot, lt, gt);
+        if(k - 1 < lt) {
+            right = lt - 1;
+        } else if(k - 1 > gt) {
+            left = gt + 1;
+        } else {
+            return pivot;
+        }
     }
+    insertion_sort(array, left, right);
+    return array[k - 1];
+}
+
+// quick_select() switches to Floyd-Rivest at this many elements.
+const size_t FLOYD_RIVEST_THRESHOLD = 1 << 20;
+// Floyd-Rivest finishes with introselect once the band is this small.
+const size_t FLOYD_RIVEST_CUTOFF = 1 << 12;
+
+/**
+ * Floyd-Rivest selection. Each round draws a random sample of about n^(2/3)
+ * elements and selects two pivots from it, u and v, whose sample ranks
+ * bracket the scaled rank of k. One dual-pivot pass then splits the subarray
+ * into < u, [u, v], and > v; with high probability rank k lands in the middle
+ * band, which is only O(n^(2/3) sqrt(log n)) long. That takes close to the
+ * minimum n + min(k, n - k) comparisons and very few passes over the data.
+ * k follows the same convention as quick_select().
+ */
+int floyd_rivest_select(int array[], size_t left, size_t right, size_t k) {
+    mt19937_64 rng(right - left);
+    size_t rounds_left = partition_round_limit(right - left + 1);
+
+    while(right - left >= FLOYD_RIVEST_CUTOFF && rounds_left-- > 0) {
+        size_t n = right - left + 1;
+        double log_n = log((double) n);
+        size_t sample_size = (size_t) pow((double) n, 2.0 / 3.0);
+        size_t gap = (size_t) sqrt(sample_size * log_n);
+
+        // Move a random sample to the front with a partial Fisher-Yates shuffle
+        for(size_t i = 0; i < sample_size; i++) {
+            swap(array[left + i], array[left + i + rng() % (n - i)]);
+        }
+
+        // Sample ranks (0-based) that bracket rank k scaled down to the sample
+        size_t scaled = (size_t) ((double) (k - 1 - left) * sample_size / n);
+        size_t low_rank = (scaled > gap) ? scaled - gap : 0;
+        size_t high_rank = min(sample_size - 1, scaled + gap);
+        size_t sample_right = left + sample_size - 1;
+        int u = quick_select(array, left, sample_right, left + low_rank + 1);
+        int v = quick_select(array, left + low_rank, sample_right, left + high_rank + 1);
+
+        // Dual-pivot partition: [left, lt) < u, [lt, gt) in [u, v], [gt, right] > v
+        size_t lt = left, gt = right + 1, i = left;
+        while(i < gt) {
+            if(array[i] < u) {
+                swap(array[lt++], array[i++]);
+            } else if(array[i] > v) {
+                swap(array[i], array[--gt]);
+            } else {
+                i++;
+            }
+        }
+
+        if(k - 1 < lt) {
+            right = lt - 1;
+        } else if(k - 1 >= gt) {
+            left = gt;
+        } else if(u == v) {
+            return u;
+        } else {
+            left = lt;
+            right = gt - 1;
+        }
+
+        // On random data the band is tiny. If it kept more than half of the
+        // subarray, the input is dominated by a few repeated values (e.g. the
+        // band holds only u and v); introselect's three-way partition settles
+        // those in one pass, whereas resampling would just repeat this round.
+        if(right - left + 1 > n / 2) {
+            break;
+        }
+    }
+    return quick_select(array, left, right, k);
 }
 
 int quick_select(int array[], const size_t length, size_t k) {
+    if(length >= FLOYD_RIVEST_THRESHOLD) {
+        return floyd_rivest_select(array, 0, length - 1, k);
+    }
     return quick_select(array, 0, length - 1, k);
 }
 
+/**
+ * Helper for multi_select(). Fills results[first..last-1] with the order
+ * statistics ranks[first..last-1] of array[left..right], partitioning only
+ * the subranges that still contain a requested rank.
+ */
+void multi_select(int array[], size_t left, size_t right,
+                  const vector<size_t> &ranks, size_t first, size_t last,
+                  vector<int> &results, size_t rounds_left) {
+    while(first < last) {
+        if(last - first == 1) {
+            // A single rank left: plain introselect is cheapest
+            results[first] = quick_select(array, left, right, ranks[first]);
+            return;
+        }
+        if(right - left < INSERTION_SORT_THRESHOLD) {
+            insertion_sort(array, left, right);
+            for(size_t r = first; r < last; r++) {
+                results[r] = array[ranks[r] - 1];
+            }
+            return;
+        }
+
+        // Same safeguard as quick_select(): median of medians once the
+        // partitions stop shrinking.
+        int pivot;
+        if(rounds_left == 0) {
+            pivot = median_of_medians(array, left, right);
+        } else {
+            rounds_left--;
+            pivot = choose_pivot(array, left, right);
+        }
+        size_t lt, gt;
+        three_way_partition(array, left, right, pivot, lt, gt);
+
+        // Ranks are 1-based, so ranks in [lt + 1, gt + 1] land on the pivot.
+        size_t mid_first = lower_bound(ranks.begin() + first, ranks.begin() + last,
+                                       lt + 1) - ranks.begin();
+        size_t mid_last = upper_bound(ranks.begin() + mid_first, ranks.begin() + last,
+                                      gt + 1) - ranks.begin();
+        for(size_t r = mid_first; r < mid_last; r++) {
+            results[r] = pivot;
+        }
+
+        // Recurse into the left side, loop on the right side
+        if(first < mid_first) {
+            multi_select(array, left, lt - 1, ranks, first, mid_first, results, rounds_left);
+        }
+        first = mid_last;
+        left = gt + 1;
+    }
+}
+
+/**
+ * Finds several order statistics of array in one pass, e.g. p50/p90/p99.
+ * ranks must be sorted in nondecreasing order and use the same 1-based
+ * convention as k in quick_select(). Returns the values in the order of ranks.
+ * Runs in about O(n log m) time for m ranks, rather than m selections.
+ */
+vector<int> multi_select(int array[], const size_t length, const vector<size_t> &ranks) {
+    vector<int> results(ranks.size());
+    if(!ranks.empty()) {
+        multi_select(array, 0, length - 1, ranks, 0, ranks.size(), results,
+                     partition_round_limit(length));
+    }
+    return results;
+}
+
+/**
+ * Mergeable KLL quantile sketch (Karnin, Lang, and Liberty) for streams too
+ * large to hold in memory. Values live in a stack of compactors; an item on
+ * level h stands for 2^h values of the stream. When the sketch is over its
+ * capacity, the lowest full level is sorted and every other item (starting at
+ * a random offset) is promoted to the next level. Memory stays O(k) and
+ * update() takes O(1) amortized time independent of the stream length.
+ */
+class KllSketch {
+public:
+    /**
+     * Constructor. Larger k gives smaller rank error; see rank_error().
+     */
+    explicit KllSketch(size_t k = 200, unsigned seed = 5489u) :
+        k_{k > MIN_K ? k : MIN_K}, count_{0}, size_{0}, capacity_{0}, levels_(1),
+        rng_{seed} {
+        capacity_ = total_capacity();
+    }
+
+    /**
+     * Returns the k needed for a normalized rank error of about epsilon.
+     */
+    static size_t k_for_rank_error(double epsilon) {
+        return (size_t) ceil(pow(RANK_ERROR_SCALE / epsilon, 1.0 / RANK_ERROR_EXPONENT));
+    }
+
+    /**
+     * Returns the normalized rank error of a single quantile query, i.e. the
+     * returned value's rank is within rank_error() * count() of the requested
+     * rank with about 99% confidence. Empirical constants from the KLL paper.
+     */
+    double rank_error() const {
+        return RANK_ERROR_SCALE / pow((double) k_, RANK_ERROR_EXPONENT);
+    }
+
+    /**
+     * Returns the number of values seen so far.
+     */
+    unsigned long long count() const {
+        return count_;
+    }
+
+    /**
+     * Adds one value from the stream.
+     */
+    void update(int value) {
+        levels_[0].push_back(value);
+        size_++;
+        count_++;
+        while(size_ > capacity_) {
+            compress();
+        }
+    }
+
+    /**
+     * Folds another sketch into this one. The result summarizes both streams.
+     */
+    void merge(const KllSketch &other) {
+        if(other.levels_.size() > levels_.size()) {
+            levels_.resize(other.levels_.size());
+            capacity_ = total_capacity();
+        }
+        for(size_t h = 0; h < other.levels_.size(); h++) {
+            levels_[h].insert(levels_[h].end(), other.levels_[h].begin(),
+                              other.levels_[h].end());
+        }
+        size_ += other.size_;
+        count_ += other.count_;
+        while(size_ > capacity_) {
+            compress();
+        }
+    }
+
+    /**
+     * Returns a value whose rank is approximately q * count(), 0 <= q <= 1.
+     * Throws out_of_range if the sketch has seen no values.
+     */
+    int quantile(double q) const {
+        if(count_ == 0) {
+            throw out_of_range("KllSketch::quantile() called on an empty sketch");
+        }
+        vector< pair<int, unsigned long long> > items;
+        items.reserve(size_);
+        for(size_t h = 0; h < levels_.size(); h++) {
+            for(size_t i = 0; i < levels_[h].size(); i++) {
+                items.push_back(make_pair(levels_[h][i], 1ULL << h));
+            }
+        }
+        sort(items.begin(), items.end());
+
+        double target = q * count_;
+        unsigned long long weight = 0;
+        for(size_t i = 0; i < items.size(); i++) {
+            weight += items[i].second;
+            if(weight >= target) {
+                return items[i].first;
+            }
+        }
+        return items.back().first;
+    }
+
+private:
+    static const size_t MIN_K = 8;
+    static constexpr double RANK_ERROR_SCALE = 1.854;
+    static constexpr double RANK_ERROR_EXPONENT = 0.9433;
+
+    size_t k_;
+    unsigned long long count_;
+    size_t size_;
+    size_t capacity_;
+    vector< vector<int> > levels_;
+    mt19937 rng_;
+
+    /**
+     * Capacity of a level: k for the top level, shrinking by 2/3 per level
+     * below it, but never less than 2.
+     */
+    size_t level_capacity(size_t level) const {
+        size_t depth = levels_.size() - 1 - level;
+        size_t cap = (size_t) ceil(k_ * pow(2.0 / 3.0, (double) depth));
+        return max(cap, (size_t) 2);
+    }
+
+    /**
+     * Total capacity over all levels. Only changes when a level is added, so
+     * it is cached in capacity_.
+     */
+    size_t total_capacity() const {
+        size_t total = 0;
+        for(size_t h = 0; h < levels_.size(); h++) {
+            total += level_capacity(h);
+        }
+        return total;
+    }
+
+    /**
+     * Compacts the lowest level that is at capacity, halving its size.
+     */
+    void compress() {
+        for(size_t h = 0; h < levels_.size(); h++) {
+            if(levels_[h].size() >= level_capacity(h)) {
+                if(h + 1 == levels_.size()) {
+                    levels_.push_back(vector<int>());
+                    capacity_ = total_capacity();
+                }
+                compact(h);
+                return;
+            }
+        }
+    }
+
+    void compact(size_t h) {
+        vector<int> &level = levels_[h];
+        vector<int> &above = levels_[h + 1];
+        sort(level.begin(), level.end());
+
+        // With an odd count, the smallest item stays behind on this level
+        size_t start = level.size() % 2;
+        size_t offset = rng_() & 1;
+        for(size_t i = start + offset; i < level.size(); i += 2) {
+            above.push_back(level[i]);
+        }
+        size_ -= (level.size() - start) / 2;
+        level.resize(start);
+    }
+};
+
+/**
+ * Exact mode for a sketched stream: returns the exact k-th smallest value
+ * (1-based, as in quick_select()) of the values in [first, last), which must
+ * be the same values that were fed into sketch. Makes one more pass over the
+ * data, keeping only the candidates whose value lies within the sketch's error
+ * band around rank k, and finishes with quick_select() on that buffer. If the
+ * sketch missed its error bound, the range is read a second time, so it must
+ * be a forward range.
+ */
+template <typename ForwardIterator>
+int exact_select(ForwardIterator first, ForwardIterator last, size_t k,
+                 const KllSketch &sketch) {
+    double n = (double) sketch.count();
+    double margin = 2 * sketch.rank_error() * n + 1;
+    int low = sketch.quantile(max(0.0, k - margin) / n);
+    int high = sketch.quantile(min(n, k + margin) / n);
+
+    vector<int> candidates;
+    size_t below = 0;
+    for(ForwardIterator it = first; it != last; ++it) {
+        if(*it < low) {
+            below++;
+        } else if(*it <= high) {
+            candidates.push_back(*it);
+        }
+    }
+    if(k <= below || k > below + candidates.size()) {
+        // The sketch missed its error bound (unlikely); keep every value
+        candidates.assign(first, last);
+        below = 0;
+    }
+    return quick_select(&candidates[0], candidates.size(), k - below);
+}
+
+// Below this many elements, parallel_quick_select() hands off to quick_select().
+const size_t PARALLEL_SELECT_CUTOFF = 1 << 16;
+
+#ifdef __AVX2__
+/**
+ * Permutation table for compressing an AVX2 vector: row m lists the lanes
+ * whose bit is set in m first, in order.
+ */
+struct CompressTable {
+    int rows[256][8];
+
+    CompressTable() {
+        for(int mask = 0; mask < 256; mask++) {
+            int n = 0;
+            for(int lane = 0; lane < 8; lane++) {
+                if(mask & (1 << lane)) {
+                    rows[mask][n++] = lane;
+                }
+            }
+            for(; n < 8; n++) {
+                rows[mask][n] = 0;
+            }
+        }
+    }
+};
+
+const CompressTable compress_table;
+#endif
+
+/**
+ * Counts the elements of src[0..length-1] that are less than and greater
+ * than pivot. Vectorized 8 lanes at a time with AVX2 when available.
+ */
+void count_partition(const int src[], size_t length, int pivot,
+                     size_t &num_less, size_t &num_greater) {
+    size_t i = 0;
+    num_less = 0;
+    num_greater = 0;
+#ifdef __AVX2__
+    const __m256i p = _mm256_set1_epi32(pivot);
+    while(i + 8 <= length) {
+        // Lane counters are flushed every block so they cannot overflow
+        size_t block_end = min(length - length % 8, i + (size_t(1) << 24));
+        __m256i less = _mm256_setzero_si256(), greater = _mm256_setzero_si256();
+        for(; i < block_end; i += 8) {
+            __m256i v = _mm256_loadu_si256((const __m256i *) (src + i));
+            // Comparison lanes are -1 when true, so subtracting counts them
+            less = _mm256_sub_epi32(less, _mm256_cmpgt_epi32(p, v));
+            greater = _mm256_sub_epi32(greater, _mm256_cmpgt_epi32(v, p));
+        }
+        int lanes[8];
+        _mm256_storeu_si256((__m256i *) lanes, less);
+        for(int lane = 0; lane < 8; lane++) {
+            num_less += (unsigned) lanes[lane];
+        }
+        _mm256_storeu_si256((__m256i *) lanes, greater);
+        for(int lane = 0; lane < 8; lane++) {
+            num_greater += (unsigned) lanes[lane];
+        }
+    }
+#endif
+    for(; i < length; i++) {
+        num_less += src[i] < pivot;
+        num_greater += src[i] > pivot;
+    }
+}
+
+/**
+ * Copies the elements of src[0..length-1] that are less than pivot (or
+ * greater than pivot, if take_greater) to dst, preserving their order.
+ * expected is the number of such elements, from count_partition(); no write
+ * goes past dst[expected - 1]. With AVX2, each vector is compressed through a
+ * lane permutation and stored whole while there is room for 8 lanes.
+ */
+void compress_partition(const int src[], size_t length, int pivot,
+                        bool take_greater, int dst[], size_t expected) {
+    size_t i = 0, written = 0;
+#ifdef __AVX2__
+    const __m256i p = _mm256_set1_epi32(pivot);
+    for(; i + 8 <= length && written < expected; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (src + i));
+        __m256i keep = take_greater ? _mm256_cmpgt_epi32(v, p) : _mm256_cmpgt_epi32(p, v);
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(keep));
+        __m256i perm = _mm256_loadu_si256((const __m256i *) compress_table.rows[mask]);
+        __m256i packed = _mm256_permutevar8x32_epi32(v, perm);
+        int n = __builtin_popcount(mask);
+        if(written + 8 <= expected) {
+            _mm256_storeu_si256((__m256i *) (dst + written), packed);
+        } else {
+            // Near the end of this output range, store only the kept lanes
+            int lanes[8];
+            _mm256_storeu_si256((__m256i *) lanes, packed);
+            copy(lanes, lanes + n, dst + written);
+        }
+        written += n;
+    }
+#endif
+    // Branchless: always store, advance only on a match. Once expected
+    // elements are written there are no more matches, so stop there.
+    for(; i < length && written < expected; i++) {
+        dst[written] = src[i];
+        written += take_greater ? src[i] > pivot : src[i] < pivot;
+    }
+}
+
+/**
+ * Selection for very large arrays, split across num_threads threads (0 means
+ * one per hardware thread). Each round, every thread counts its chunk against
+ * the pivot; the counts are combined to find which side holds rank k, and then
+ * every thread copies only that side of its chunk into a scratch buffer at its
+ * offset. The input array is left unchanged. k is 1-based, as in
+ * quick_select(). Build with -pthread, and -mavx2 for the vectorized kernels.
+ */
+int parallel_quick_select(const int array[], const size_t length, size_t k,
+                          unsigned num_threads = 0) {
+    if(num_threads == 0) {
+        num_threads = max(1u, thread::hardware_concurrency());
+    }
+    if(length <= PARALLEL_SELECT_CUTOFF) {
+        vector<int> copy_of_array(array, array + length);
+        return quick_select(&copy_of_array[0], length, k);
+    }
+
+    // The first round reads the input directly; later rounds ping-pong
+    // between two scratch buffers, the second sized by the first round.
+    vector<int> first_buffer, second_buffer;
+    const int *src = array;
+    size_t n = length;
+    size_t rounds_left = partition_round_limit(length);
+    vector<size_t> num_less(num_threads), num_greater(num_threads);
+    vector<thread> workers;
+
+    while(n > PARALLEL_SELECT_CUTOFF && rounds_left-- > 0) {
+        int pivot = choose_pivot(src, 0, n - 1);
+        size_t chunk = (n + num_threads - 1) / num_threads;
+
+        for(unsigned t = 0; t < num_threads; t++) {
+            size_t begin = min(n, t * chunk), end = min(n, begin + chunk);
+            workers.push_back(thread(count_partition, src + begin, end - begin, pivot,
+                                     ref(num_less[t]), ref(num_greater[t])));
+        }
+        for(size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+        workers.clear();
+
+        size_t total_less = 0, total_greater = 0;
+        for(unsigned t = 0; t < num_threads; t++) {
+            total_less += num_less[t];
+            total_greater += num_greater[t];
+        }
+        bool take_greater;
+        if(k - 1 < total_less) {
+            take_greater = false;
+        } else if(k - 1 >= n - total_greater) {
+            take_greater = true;
+            k -= n - total_greater;
+        } else {
+            return pivot;
+        }
+        const vector<size_t> &side_counts = take_greater ? num_greater : num_less;
+        size_t side_total = take_greater ? total_greater : total_less;
+
+        vector<int> *dst_buffer = &first_buffer;
+        if(src == first_buffer.data()) {
+            dst_buffer = &second_buffer;
+        }
+        if(dst_buffer->size() < side_total) {
+            dst_buffer->resize(side_total);
+        }
+        int *dst = &(*dst_buffer)[0];
+
+        size_t offset = 0;
+        for(unsigned t = 0; t < num_threads; t++) {
+            size_t begin = min(n, t * chunk), end = min(n, begin + chunk);
+            workers.push_back(thread(compress_partition, src + begin, end - begin, pivot,
+                                     take_greater, dst + offset, side_counts[t]));
+            offset += side_counts[t];
+        }
+        for(size_t t = 0; t < workers.size(); t++) {
+            workers[t].join();
+        }
+        workers.clear();
+
+        src = dst;
+        n = side_total;
+    }
+
+    // Small enough (or the pivots kept missing): finish serially in scratch
+    vector<int> rest(src, src + n);
+    return quick_select(&rest[0], n, k);
+}
+
+/**
+ * Reports a mismatch between a selection routine and the reference on cerr.
+ * Returns true if they agree.
+ */
+bool check_result(const string &name, size_t length, size_t k, int expected, int actual) {
+    if(expected != actual) {
+        cerr << "Error: " << name << " returned " << actual << " for k = " << k
+             << " of " << length << " values; expected " << expected << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Cross-checks every selection routine in this file against a sorted copy on
+ * random input of the given length: uniform values, few distinct values, and
+ * already sorted values. Returns true if all of them agree.
+ */
+bool check_selection(size_t length) {
+    mt19937 rng(length);
+    const unsigned distinct_counts[] = {0, 2, 16};
+    bool ok = true;
+
+    for(int pattern = 0; pattern < 4; pattern++) {
+        vector<int> values(length);
+        for(size_t i = 0; i < length; i++) {
+            if(pattern == 3) {
+                values[i] = (int) i;
+            } else if(distinct_counts[pattern] == 0) {
+                values[i] = (int) rng();
+            } else {
+                values[i] = (int) (rng() % distinct_counts[pattern]);
+            }
+        }
+        vector<int> sorted_values(values);
+        sort(sorted_values.begin(), sorted_values.end());
+
+        vector<size_t> ranks;
+        ranks.push_back(1);
+        ranks.push_back(length / 2 + 1);
+        ranks.push_back(length - length / 100);
+        ranks.push_back(length);
+        for(size_t r = 0; r < ranks.size(); r++) {
+            size_t k = ranks[r];
+            int expected = sorted_values[k - 1];
+
+            vector<int> scratch(values);
+            ok &= check_result("quick_select", length, k, expected,
+                               quick_select(&scratch[0], length, k));
+            scratch = values;
+            ok &= check_result("floyd_rivest_select", length, k, expected,
+                               floyd_rivest_select(&scratch[0], 0, length - 1, k));
+            ok &= check_result("parallel_quick_select", length, k, expected,
+                               parallel_quick_select(&values[0], length, k, 3));
+
+            KllSketch sketch;
+            for(size_t i = 0; i < length; i++) {
+                sketch.update(values[i]);
+            }
+            ok &= check_result("exact_select", length, k, expected,
+                               exact_select(values.begin(), values.end(), k, sketch));
+        }
+
+        vector<int> scratch(values);
+        vector<int> results = multi_select(&scratch[0], length, ranks);
+        for(size_t r = 0; r < ranks.size(); r++) {
+            ok &= check_result("multi_select", length, ranks[r],
+                               sorted_values[ranks[r] - 1], results[r]);
+        }
+    }
+    return ok;
+}
+
 int main(int argc, char *argv[]) {
+    if(argc == 3 && string(argv[1]) == "--check") {
+        size_t length;
+        istringstream length_iss(argv[2]);
+        if(!(length_iss >> length) || length == 0 || argv[2][0] == '-') {
+            cerr << "Error: Invalid length '" << argv[2] << "'." << endl;
+            return 1;
+        }
+        if(!check_selection(length)) {
+            return 1;
+        }
+        cout << "All selection routines agree on " << length << " values." << endl;
+        return 0;
+    }
+
     if (argc != 2) {
-        cerr << "Usage: " << argv[0] << " <k>" << endl;
+        cerr << "Usage: " << argv[0] << " <k>" << endl
+             << "       " << argv[0] << " --check <length>" << endl;
         return 1;
     }
 
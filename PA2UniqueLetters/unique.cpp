@@ -4,17 +4,56 @@
  ******************************************************************************/
 #include <iostream>
 #include <cctype>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
-bool is_all_lowercase(const string &s) {
-    // TODO: returns true if all characters in string are lowercase
-    // letters in the English alphabet; false otherwise.
-    int ascii_val;
+// A string of lowercase letters longer than this must repeat a letter.
+const size_t ALPHABET_SIZE = 26;
 
-    for(int i = 0; i < (int) s.length(); i++) {     // Iterating over every character in the string
-        ascii_val = s[i];
-        if(ascii_val < 'a' || ascii_val > 'z') {    // If ASCII value of the char. is outside the range of values for lowercase letters
+/**
+ * Returns true if all len bytes at p are in 'a'..'z'. Checks 32 bytes per
+ * iteration with AVX2 (16 with SSE2): the bytes are compared against both ends
+ * of the range as signed values, so bytes >= 0x80 also fail, and one movemask
+ * tells whether every lane passed. The tail is checked one byte at a time.
+ */
+bool is_all_lowercase(const char *p, size_t len) {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i below = _mm256_set1_epi8('a' - 1), above = _mm256_set1_epi8('z' + 1);
+    for(; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (p + i));
+        __m256i ok = _mm256_and_si256(_mm256_cmpgt_epi8(v, below), _mm256_cmpgt_epi8(above, v));
+        if(_mm256_movemask_epi8(ok) != -1) {
+            return false;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i below = _mm_set1_epi8('a' - 1), above = _mm_set1_epi8('z' + 1);
+    for(; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (p + i));
+        __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(v, below), _mm_cmpgt_epi8(above, v));
+        if(_mm_movemask_epi8(ok) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for(; i < len; i++) {                           // Iterating over the remaining characters
+        if(p[i] < 'a' || p[i] > 'z') {              // If ASCII value of the char. is outside the range of values for lowercase letters
             return false;
         }
     }
@@ -22,6 +61,12 @@ bool is_all_lowercase(const string &s) {
     return true;
 }
 
+bool is_all_lowercase(const string &s) {
+    // TODO: returns true if all characters in string are lowercase
+    // letters in the English alphabet; false otherwise.
+    return is_all_lowercase(s.data(), s.length());
+}
+
 bool all_unique_letters(const string &s) {
     // TODO: returns true if all letters in string are unique, that is
     // no duplicates are found; false otherwise.
@@ -32,6 +77,11 @@ bool all_unique_letters(const string &s) {
 
     unsigned int used_chars = 0;
 
+    // Only 26 letters exist, so a longer (lowercase) string has a duplicate
+    if(s.length() > ALPHABET_SIZE) {
+        return false;
+    }
+
     for(int i = 0; i < (int) s.length(); i++) {         // Iterating over every character in the string
         int num_of_shifts = ('z' - s[i]);
         unsigned int curr_char = 0x1 << num_of_shifts;  // Setting the letter's corresponding bit to 1 in unsigned int used for comparison
@@ -47,23 +97,446 @@ bool all_unique_letters(const string &s) {
 
 }
 
+enum letters_t { NOT_LOWERCASE, DUPLICATE_LETTERS, UNIQUE_LETTERS };
+
+/**
+ * Validates s and checks it for duplicate letters in one pass. Strings of up
+ * to 26 bytes are checked byte by byte, setting letter bits as they are
+ * validated (a repeat is noted, but the rest must still be validated). Longer
+ * strings can only be lowercase with a repeat, so they just need the
+ * vectorized range check, which stops at the first bad 32-byte block.
+ */
+letters_t check_letters(const char *s, size_t len) {
+    if(len > ALPHABET_SIZE) {
+        return is_all_lowercase(s, len) ? DUPLICATE_LETTERS : NOT_LOWERCASE;
+    }
+
+    unsigned int used_chars = 0;
+    bool duplicate = false;
+    for(size_t i = 0; i < len; i++) {
+        if(s[i] < 'a' || s[i] > 'z') {
+            return NOT_LOWERCASE;
+        }
+        unsigned int curr_char = 0x1 << ('z' - s[i]);
+        duplicate = duplicate || (curr_char & used_chars);
+        used_chars = used_chars | curr_char;
+    }
+    return duplicate ? DUPLICATE_LETTERS : UNIQUE_LETTERS;
+}
+
+letters_t check_letters(const string &s) {
+    return check_letters(s.data(), s.length());
+}
+
+enum symbols_t { INVALID_SYMBOL, DUPLICATE_SYMBOL, UNIQUE_SYMBOLS };
+
+/**
+ * Result of find_duplicate(): the outcome, and for an invalid or repeated
+ * symbol, the byte offset at which it starts (string::npos otherwise).
+ */
+struct DuplicateResult {
+    symbols_t result;
+    size_t position;
+};
+
+/**
+ * Alphabet of the 26 lowercase letters. The seen-set is a single unsigned int,
+ * so find_duplicate<LowercaseLetters> compiles to the same loop as
+ * all_unique_letters().
+ */
+struct LowercaseLetters {
+    class Set {
+    public:
+        Set() : bits_{0} { }
+
+        // Returns false if symbol was already in the set
+        bool insert(unsigned symbol) {
+            unsigned int bit = 0x1u << symbol;
+            bool fresh = !(bits_ & bit);
+            bits_ |= bit;
+            return fresh;
+        }
+
+    private:
+        unsigned int bits_;
+    };
+
+    // Decodes one symbol at p; returns its length in bytes, or 0 if invalid
+    static size_t decode(const char *p, size_t, unsigned &symbol) {
+        if(*p < 'a' || *p > 'z') {
+            return 0;
+        }
+        symbol = *p - 'a';
+        return 1;
+    }
+};
+
+/**
+ * Alphabet of all 256 byte values, tracked in a 256-bit bitset.
+ */
+struct Bytes {
+    class Set {
+    public:
+        Set() : words_() { }
+
+        bool insert(unsigned symbol) {
+            unsigned long long bit = 1ULL << (symbol % 64);
+            bool fresh = !(words_[symbol / 64] & bit);
+            words_[symbol / 64] |= bit;
+            return fresh;
+        }
+
+    private:
+        unsigned long long words_[4];
+    };
+
+    static size_t decode(const char *p, size_t, unsigned &symbol) {
+        symbol = (unsigned char) *p;
+        return 1;
+    }
+};
+
+/**
+ * Alphabet of Unicode code points, decoded from UTF-8. ASCII goes into a
+ * 128-bit bitmap; anything else goes into a small open-addressing hash set
+ * that only allocates once a non-ASCII code point shows up.
+ */
+struct CodePoints {
+    class Set {
+    public:
+        Set() : ascii_(), size_{0} { }
+
+        bool insert(unsigned symbol) {
+            if(symbol < 128) {
+                unsigned long long bit = 1ULL << (symbol % 64);
+                bool fresh = !(ascii_[symbol / 64] & bit);
+                ascii_[symbol / 64] |= bit;
+                return fresh;
+            }
+            if(2 * (size_ + 1) > slots_.size()) {
+                grow();
+            }
+            // Slots hold symbol + 1, so 0 marks an empty slot
+            size_t mask = slots_.size() - 1;
+            for(size_t i = hash(symbol) & mask; ; i = (i + 1) & mask) {
+                if(slots_[i] == symbol + 1) {
+                    return false;
+                }
+                if(slots_[i] == 0) {
+                    slots_[i] = symbol + 1;
+                    size_++;
+                    return true;
+                }
+            }
+        }
+
+    private:
+        unsigned long long ascii_[2];
+        vector<unsigned> slots_;
+        size_t size_;
+
+        static size_t hash(unsigned symbol) {
+            return (symbol * 2654435761u) >> 7;
+        }
+
+        void grow() {
+            vector<unsigned> old;
+            old.swap(slots_);
+            slots_.assign(old.empty() ? 32 : 2 * old.size(), 0);
+            size_t mask = slots_.size() - 1;
+            for(size_t j = 0; j < old.size(); j++) {
+                if(old[j] != 0) {
+                    size_t i = hash(old[j] - 1) & mask;
+                    while(slots_[i] != 0) {
+                        i = (i + 1) & mask;
+                    }
+                    slots_[i] = old[j];
+                }
+            }
+        }
+    };
+
+    /**
+     * Strict UTF-8 decoding: rejects stray continuation bytes, truncated and
+     * overlong sequences, surrogates, and code points above U+10FFFF.
+     */
+    static size_t decode(const char *p, size_t len, unsigned &symbol) {
+        const unsigned char *u = (const unsigned char *) p;
+        size_t n;
+        unsigned min_value;
+        if(u[0] < 0x80) {
+            symbol = u[0];
+            return 1;
+        } else if((u[0] & 0xE0) == 0xC0) {
+            n = 2;
+            symbol = u[0] & 0x1F;
+            min_value = 0x80;
+        } else if((u[0] & 0xF0) == 0xE0) {
+            n = 3;
+            symbol = u[0] & 0x0F;
+            min_value = 0x800;
+        } else if((u[0] & 0xF8) == 0xF0) {
+            n = 4;
+            symbol = u[0] & 0x07;
+            min_value = 0x10000;
+        } else {
+            return 0;
+        }
+        if(n > len) {
+            return 0;
+        }
+        for(size_t i = 1; i < n; i++) {
+            if((u[i] & 0xC0) != 0x80) {
+                return 0;
+            }
+            symbol = (symbol << 6) | (u[i] & 0x3F);
+        }
+        if(symbol < min_value || symbol > 0x10FFFF || (symbol >= 0xD800 && symbol <= 0xDFFF)) {
+            return 0;
+        }
+        return n;
+    }
+};
+
+/**
+ * Generalized duplicate detection over any alphabet above (LowercaseLetters,
+ * Bytes, or CodePoints). Stops at the first symbol that is invalid for the
+ * alphabet or was seen before, and reports where it starts.
+ */
+template <typename Alphabet>
+DuplicateResult find_duplicate(const char *s, size_t len) {
+    typename Alphabet::Set seen;
+    for(size_t i = 0; i < len; ) {
+        unsigned symbol;
+        size_t n = Alphabet::decode(s + i, len - i, symbol);
+        if(n == 0) {
+            DuplicateResult invalid = { INVALID_SYMBOL, i };
+            return invalid;
+        }
+        if(!seen.insert(symbol)) {
+            DuplicateResult duplicate = { DUPLICATE_SYMBOL, i };
+            return duplicate;
+        }
+        i += n;
+    }
+    DuplicateResult unique = { UNIQUE_SYMBOLS, string::npos };
+    return unique;
+}
+
+template <typename Alphabet>
+DuplicateResult find_duplicate(const string &s) {
+    return find_duplicate<Alphabet>(s.data(), s.length());
+}
+
+// Bytes of the token file handled per work item in batch mode, and how many
+// finished work items may wait to be written, per worker thread.
+const size_t BATCH_BLOCK_SIZE = 8 << 20;
+const size_t BLOCKS_IN_FLIGHT_PER_THREAD = 4;
+
+const char * const LETTERS_NAMES[] = { "invalid", "duplicate", "unique" };
+
+/**
+ * Checks every newline-delimited token in data[begin..end), where begin is
+ * the start of a line. A line that starts in the range is handled here even
+ * if it ends past end. Adds to counts, and unless count_only appends one
+ * result word per line to out.
+ */
+void check_block(const char *data, size_t size, size_t begin, size_t end,
+                 bool count_only, size_t counts[3], string &out) {
+    size_t pos = begin;
+    while(pos < end) {
+        const char *line = data + pos;
+        const char *newline = (const char *) memchr(line, '\n', size - pos);
+        size_t len = newline ? newline - line : size - pos;
+        pos += len + 1;
+        if(len > 0 && line[len - 1] == '\r') {
+            len--;
+        }
+        letters_t result = check_letters(line, len);
+        counts[result]++;
+        if(!count_only) {
+            out += LETTERS_NAMES[result];
+            out += '\n';
+        }
+    }
+}
+
+/**
+ * Batch mode: checks every line of the token file at path, which is mapped
+ * into memory rather than read. The file is cut into blocks that start at
+ * line boundaries; num_threads workers claim blocks in order and check them
+ * into private buffers, which the calling thread writes in file order (one
+ * of "unique", "duplicate", or "invalid" per line). With count_only, only the
+ * totals are printed. Returns the process exit status.
+ */
+int check_file(const char *path, unsigned num_threads, bool count_only) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0) {
+        cerr << "Error: Cannot open file '" << path << "'." << endl;
+        if(fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+    size_t size = st.st_size;
+    const char *data = nullptr;
+    if(size > 0) {
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED) {
+            cerr << "Error: Cannot map file '" << path << "'." << endl;
+            close(fd);
+            return 1;
+        }
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = (const char *) mapped;
+    }
+
+    // Block boundaries, each moved forward to just past a newline
+    vector<size_t> bounds(1, 0);
+    while(bounds.back() < size) {
+        size_t next = bounds.back() + BATCH_BLOCK_SIZE;
+        if(next >= size) {
+            next = size;
+        } else {
+            const char *newline = (const char *) memchr(data + next, '\n', size - next);
+            next = newline ? newline - data + 1 : size;
+        }
+        bounds.push_back(next);
+    }
+    const size_t num_blocks = bounds.size() - 1;
+    const size_t window = num_threads * BLOCKS_IN_FLIGHT_PER_THREAD;
+
+    vector<string> buffers(window);
+    vector<bool> ready(window, false);
+    vector<size_t> totals(3, 0);
+    size_t next_block = 0, written = 0;
+    mutex lock;
+    condition_variable changed;
+
+    auto worker = [&]() {
+        size_t counts[3] = {0, 0, 0};
+        while(true) {
+            size_t block;
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [&]() {
+                    return next_block == num_blocks || count_only ||
+                           next_block < written + window;
+                });
+                if(next_block == num_blocks) {
+                    break;
+                }
+                block = next_block++;
+            }
+
+            string out;
+            check_block(data, size, bounds[block], bounds[block + 1], count_only, counts, out);
+
+            if(!count_only) {
+                unique_lock<mutex> guard(lock);
+                buffers[block % window].swap(out);
+                ready[block % window] = true;
+                changed.notify_all();
+            }
+        }
+        unique_lock<mutex> guard(lock);
+        for(int r = 0; r < 3; r++) {
+            totals[r] += counts[r];
+        }
+    };
+
+    vector<thread> workers;
+    for(unsigned t = 0; t < num_threads; t++) {
+        workers.push_back(thread(worker));
+    }
+    if(!count_only) {
+        for(size_t block = 0; block < num_blocks; block++) {
+            string out;
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [&]() { return ready[block % window]; });
+                out.swap(buffers[block % window]);
+                ready[block % window] = false;
+                written++;
+                changed.notify_all();
+            }
+            cout.write(out.data(), out.size());
+        }
+    }
+    for(size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+
+    if(count_only) {
+        cout << "Unique: " << totals[UNIQUE_LETTERS] << endl;
+        cout << "Duplicate: " << totals[DUPLICATE_LETTERS] << endl;
+        cout << "Invalid: " << totals[NOT_LOWERCASE] << endl;
+    }
+    cout << flush;
+
+    if(size > 0) {
+        munmap((void *) data, size);
+    }
+    close(fd);
+    return 0;
+}
+
 int main(int argc, char * const argv[]) {
     // TODO: reads and parses command line arguments.
     // Calls other functions to produce correct output.
 
+    if(argc >= 3 && string(argv[1]) == "--batch") {    // Batch mode over a file of tokens
+        unsigned num_threads = max(1u, thread::hardware_concurrency());
+        bool count_only = false;
+        for(int i = 3; i < argc; i++) {
+            string option = argv[i];
+            int threads;
+            if(option == "--count") {
+                count_only = true;
+            } else if(option == "--threads" && i + 1 < argc &&
+                      (istringstream(argv[i + 1]) >> threads) && threads > 0) {
+                num_threads = threads;
+                i++;
+            } else {
+                cerr << "Usage: ./unique --batch <file> [--threads <n>] [--count]" << endl;
+                return 1;
+            }
+        }
+        return check_file(argv[2], num_threads, count_only);
+    }
+
+    if(argc == 3 && (string(argv[1]) == "--bytes" || string(argv[1]) == "--utf8")) {
+        // Full-byte or UTF-8 code point alphabet
+        bool utf8 = string(argv[1]) == "--utf8";
+        DuplicateResult found = utf8 ? find_duplicate<CodePoints>(argv[2])
+                                     : find_duplicate<Bytes>(argv[2]);
+        if(found.result == INVALID_SYMBOL) {
+            cerr << "Error: Invalid UTF-8 at byte " << found.position << "." << endl;
+            return 1;
+        }
+        if(found.result == UNIQUE_SYMBOLS) {
+            cout << "All characters are unique." << endl;
+        } else {
+            cout << "Duplicate character found at byte " << found.position << "." << endl;
+        }
+        return 0;
+    }
+
     if(argc != 2) {                                     // If user did not provide proper amount of arguments
         cerr << "Usage: ./unique <string>" << endl;
         return 1;
     }
 
     string s = argv[1];
+    letters_t result = check_letters(s);
 
-    if(!(is_all_lowercase(s))) {                        // If string does not contain all lowercase letters
+    if(result == NOT_LOWERCASE) {                       // If string does not contain all lowercase letters
         cerr << "Error: String must contain only lowercase letters." << endl;
         return 1;
     }
 
-    if(all_unique_letters(s)) {                         // If all letters in the string are unique
+    if(result == UNIQUE_LETTERS) {                      // If all letters in the string are unique
         cout << "All letters are unique." << endl;
     } else {                                            // If not all letters in the string are unique
         cout << "Duplicate letters found." << endl;
@@ -7,95 +7,555 @@
 #include <algorithm>
 #include <sstream>
 #include <iomanip>
+#include <string>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "../Common/biguint.h"
 
 using namespace std;
 
-vector<vector<int>> total_ways;
-vector<int> steps;
+// Below this many stairs, count_ways() just runs the recurrence.
+const int COUNT_DP_THRESHOLD = 1000;
 
-vector< vector<int> > get_ways(int num_stairs) {
+// Step sizes used when none are given: 1, 2, or 3 stairs at a time.
+const vector<int> DEFAULT_STEPS = {1, 2, 3};
+
+/**
+ * Returns the number of ways to climb num_stairs stairs using step_sizes
+ * (sorted, distinct, positive) without listing them. Counts satisfy
+ * W(n) = sum of W(n - s) over the step sizes s, with W(0) = 1.
+ * For the default steps this is the tribonacci recurrence. Moderate n uses the
+ * recurrence directly; larger n computes x^n mod (x^3 - x^2 - x - 1) =
+ * a x^2 + b x + c by repeated squaring, the polynomial form of raising the
+ * 3x3 companion matrix to the n-th power (6 big multiplications per bit
+ * instead of 27), and W(n) = 2a + b + c.
+ */
+BigUInt count_ways(int num_stairs, const vector<int> &step_sizes = DEFAULT_STEPS) {
+    if(step_sizes != DEFAULT_STEPS || num_stairs < COUNT_DP_THRESHOLD) {
+        // Only the last max-step counts feed the next one, so keep them in a
+        // ring buffer: W(i) lives in counts[i % window]. Steps longer than
+        // the whole climb never apply, so they do not widen the window.
+        size_t window = min<size_t>(step_sizes.back(), num_stairs) + 1;
+        vector<BigUInt> counts(window);
+        counts[0] = 1;
+        for(int i = 1; i <= num_stairs; i++) {
+            BigUInt &count = counts[i % window];
+            count = 0;
+            for(size_t j = 0; j < step_sizes.size() && step_sizes[j] <= i; j++) {
+                count += counts[(i - step_sizes[j]) % window];
+            }
+        }
+        return counts[num_stairs % window];
+    }
+
+    BigUInt a = 0, b = 0, c = 1;
+    int top_bit = 30;
+    while(!(num_stairs & (1 << top_bit))) {
+        top_bit--;
+    }
+    for(int bit = top_bit; bit >= 0; bit--) {
+        // Square, then reduce with x^3 = x^2 + x + 1 and x^4 = 2x^2 + 2x + 1
+        BigUInt x4 = a * a, ab = a * b, ac = a * c, bc = b * c;
+        BigUInt x3 = ab + ab;
+        BigUInt x2 = b * b + ac + ac;
+        BigUInt x1 = bc + bc;
+        BigUInt x0 = c * c;
+        a = x2 + x3 + x4 + x4;
+        b = x1 + x3 + x4 + x4;
+        c = x0 + x3 + x4;
+        if(num_stairs & (1 << bit)) {
+            // Multiply by x
+            BigUInt old_a = a;
+            a = a + b;
+            b = old_a + c;
+            c = old_a;
+        }
+    }
+    return a + a + b + c;
+}
+
+/**
+ * Lazily enumerates the ways to climb num_stairs stairs, one at a time, in
+ * order of the first differing step. The current path doubles as an explicit
+ * stack of the steps taken, so memory stays O(n) and the caller may stop at
+ * any point. Holds no shared state, so enumerators may run on any thread.
+ */
+class WayEnumerator {
+public:
+    explicit WayEnumerator(int num_stairs, const vector<int> &step_sizes = DEFAULT_STEPS) :
+        steps_(step_sizes), remaining_{num_stairs} {
+        build_reachable(num_stairs);
+        primed_ = reachable_[num_stairs];
+        if(primed_) {
+            path_.reserve(num_stairs);
+            fill_first();
+        }
+    }
+
+    /**
+     * Constructor that starts the enumeration at first_way (e.g. from
+     * unrank_way()) instead of at the first way in order.
+     */
+    explicit WayEnumerator(const vector<int> &first_way,
+                           const vector<int> &step_sizes = DEFAULT_STEPS) :
+        steps_(step_sizes), remaining_{0}, primed_{true}, path_(first_way) {
+        int num_stairs = 0;
+        for(size_t i = 0; i < first_way.size(); i++) {
+            num_stairs += first_way[i];
+        }
+        build_reachable(num_stairs);
+    }
+
+    /**
+     * Advances to the next way. Returns false once every way has been seen.
+     */
+    bool next() {
+        if(primed_) {
+            primed_ = false;
+            return true;
+        }
+        // Pop steps until one can be replaced by the next larger step
+        while(!path_.empty()) {
+            int last = path_.back();
+            path_.pop_back();
+            remaining_ += last;
+            size_t j = upper_bound(steps_.begin(), steps_.end(), last) - steps_.begin();
+            for(; j < steps_.size() && steps_[j] <= remaining_; j++) {
+                if(reachable_[remaining_ - steps_[j]]) {
+                    path_.push_back(steps_[j]);
+                    remaining_ -= steps_[j];
+                    fill_first();
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Returns the current way, valid until the next call to next().
+     */
+    const vector<int>& way() const {
+        return path_;
+    }
+
+private:
+    vector<int> steps_;
+    // reachable_[r] is true if exactly r stairs can be climbed with steps_
+    vector<bool> reachable_;
+    int remaining_;
+    bool primed_;
+    vector<int> path_;
+
+    void build_reachable(int num_stairs) {
+        reachable_.assign(num_stairs + 1, false);
+        reachable_[0] = true;
+        for(int r = 1; r <= num_stairs; r++) {
+            for(size_t j = 0; j < steps_.size() && steps_[j] <= r; j++) {
+                if(reachable_[r - steps_[j]]) {
+                    reachable_[r] = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // The first way in order below any prefix takes the smallest step that
+    // still leaves a climbable remainder, each time
+    void fill_first() {
+        while(remaining_ > 0) {
+            for(size_t j = 0; j < steps_.size(); j++) {
+                if(reachable_[remaining_ - steps_[j]]) {
+                    path_.push_back(steps_[j]);
+                    remaining_ -= steps_[j];
+                    break;
+                }
+            }
+        }
+    }
+};
+
+vector< vector<int> > get_ways(int num_stairs, const vector<int> &step_sizes = DEFAULT_STEPS) {
     // Returns a vector of vectors of ints representing
     // the different combinations of ways to climb num_stairs
-    // stairs, moving up either 1, 2, or 3 stairs at a time.
-    
-    if(num_stairs == 0) {
-        // If there are no stairs:
-        total_ways.push_back(steps);
-    } else if(num_stairs == 1) {
-        // If there is only 1 stair:
-        // Recursive call for only possible way to climb
-        steps.push_back(1);
-        get_ways(num_stairs - 1);
-        steps.pop_back();
-    } else if(num_stairs == 2) {
-        // If there are only 2 stairs:
-        // Recursive calls for all two possible ways to climb
-        steps.push_back(1);
-        get_ways(num_stairs - 1);
-        steps.pop_back();
-        steps.push_back(2);
-        get_ways(num_stairs - 2);
-        steps.pop_back();
-    } else {
-        // If the number of stairs is 3 or greater:
-        // Recursive calls for all three possible ways to climb
-        steps.push_back(1);
-        get_ways(num_stairs - 1);
-        steps.pop_back();
-        steps.push_back(2);
-        get_ways(num_stairs - 2);
-        steps.pop_back();
-        steps.push_back(3);
-        get_ways(num_stairs - 3);
-        steps.pop_back();
-    }
-
-    return total_ways;
+    // stairs, moving up by any of step_sizes stairs at a time.
+    vector< vector<int> > ways;
+    WayEnumerator enumerator(num_stairs, step_sizes);
+    while(enumerator.next()) {
+        ways.push_back(enumerator.way());
+    }
+    return ways;
+}
+
+/**
+ * Returns the counts W(0), ..., W(num_stairs) of ways to climb each number of
+ * stairs with step_sizes, as 64-bit values. Throws out_of_range if W(r) does
+ * not fit (with the default steps, beyond 73 stairs).
+ */
+vector<unsigned long long> way_counts(int num_stairs,
+                                      const vector<int> &step_sizes = DEFAULT_STEPS) {
+    const unsigned long long max_count = ~0ULL;
+    vector<unsigned long long> counts(num_stairs + 1, 0);
+    counts[0] = 1;
+    for(int i = 1; i <= num_stairs; i++) {
+        for(size_t j = 0; j < step_sizes.size() && step_sizes[j] <= i; j++) {
+            unsigned long long add = counts[i - step_sizes[j]];
+            if(counts[i] > max_count - add) {
+                throw out_of_range("Number of stairs out of range for ranking.");
+            }
+            counts[i] += add;
+        }
+    }
+    return counts;
+}
+
+/**
+ * Returns the k-th way (1-based, as numbered by display_ways()) to climb
+ * num_stairs stairs without enumerating the ones before it. Ways that start
+ * with a step of s come after all W(n - t) ways starting with a smaller step
+ * t, so each step is picked by skipping over those prefix counts. O(n) per
+ * call for a fixed step set. Throws out_of_range if the counts do not fit in
+ * 64 bits or k is not in [1, W(num_stairs)].
+ */
+vector<int> unrank_way(int num_stairs, unsigned long long k,
+                       const vector<int> &step_sizes = DEFAULT_STEPS) {
+    if(num_stairs < 0) {
+        throw out_of_range("Number of stairs out of range for ranking.");
+    }
+    vector<unsigned long long> counts = way_counts(num_stairs, step_sizes);
+    if(k < 1 || k > counts[num_stairs]) {
+        throw out_of_range("Way number out of range.");
+    }
 
+    vector<int> way;
+    unsigned long long index = k - 1;
+    for(int remaining = num_stairs; remaining > 0; ) {
+        for(size_t j = 0; j < step_sizes.size() && step_sizes[j] <= remaining; j++) {
+            int step = step_sizes[j];
+            if(index < counts[remaining - step]) {
+                way.push_back(step);
+                remaining -= step;
+                break;
+            }
+            index -= counts[remaining - step];
+        }
+    }
+    return way;
+}
+
+/**
+ * Returns the 1-based position of way in the order used by display_ways().
+ * The inverse of unrank_way(). Throws out_of_range if a step is not one of
+ * step_sizes or the counts do not fit in 64 bits.
+ */
+unsigned long long rank_way(const vector<int> &way,
+                            const vector<int> &step_sizes = DEFAULT_STEPS) {
+    int num_stairs = 0;
+    for(size_t i = 0; i < way.size(); i++) {
+        if(!binary_search(step_sizes.begin(), step_sizes.end(), way[i])) {
+            throw out_of_range("Way uses a step size that is not allowed.");
+        }
+        num_stairs += way[i];
+    }
+    vector<unsigned long long> counts = way_counts(num_stairs, step_sizes);
+
+    unsigned long long index = 0;
+    int remaining = num_stairs;
+    for(size_t i = 0; i < way.size(); i++) {
+        for(size_t j = 0; step_sizes[j] < way[i]; j++) {
+            if(step_sizes[j] <= remaining) {
+                index += counts[remaining - step_sizes[j]];
+            }
+        }
+        remaining -= way[i];
+    }
+    return index + 1;
+}
+
+/**
+ * Writes the decimal digits of value at p and returns the end of the digits.
+ */
+inline char* format_number(char *p, unsigned long long value) {
+    char digits[20];
+    int length = 0;
+    do {
+        digits[length++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while(value > 0);
+    while(length > 0) {
+        *p++ = digits[--length];
+    }
+    return p;
 }
 
+/**
+ * Returns an upper bound on the length of the line format_way() writes.
+ */
+inline size_t max_way_length(const vector<int> &way) {
+    // " " + 20 digits + ". [" + "]\n", then ", " + up to 10 digits per step
+    return 26 + 12 * way.size();
+}
+
+/**
+ * Writes one numbered way, e.g. " 3. [1, 2, 1]", and a newline at p, which
+ * must have room for max_way_length(way) chars. Returns the end of the line.
+ * pad adds a leading space to single-digit numbers when there are more than
+ * 9 ways in total.
+ */
+char* format_way(char *p, unsigned long long number, const vector<int> &way, bool pad) {
+    // Number formatting for when there are more than 9 total ways
+    if(pad && number < 10) {
+        *p++ = ' ';
+    }
+    p = format_number(p, number);
+    *p++ = '.';
+    *p++ = ' ';
+    *p++ = '[';
+
+    // Writing actual steps; single-digit steps skip the digit loop
+    for(size_t j = 0; j < way.size(); j++) {
+        if(j != 0) {
+            *p++ = ',';
+            *p++ = ' ';
+        }
+        if(way[j] < 10) {
+            *p++ = (char) ('0' + way[j]);
+        } else {
+            p = format_number(p, way[j]);
+        }
+    }
+    *p++ = ']';
+    *p++ = '\n';
+    return p;
+}
+
+/**
+ * Appends one numbered way, formatted by format_way(), to out.
+ */
+void append_way(string &out, unsigned long long number, const vector<int> &way, bool pad) {
+    size_t start = out.size();
+    out.resize(start + max_way_length(way));
+    char *end = format_way(&out[start], number, way, pad);
+    out.resize(end - &out[0]);
+}
+
+/**
+ * Buffered writer for the numbered listing. Lines are formatted by hand into
+ * a large buffer that goes to the stream in one write when full, instead of
+ * pushing every number through operator<< and flushing every line.
+ */
+class WayWriter {
+public:
+    explicit WayWriter(bool pad, ostream &out = cout) :
+        pad_{pad}, out_(out), buffer_(BUFFER_SIZE), used_{0} { }
+
+    ~WayWriter() {
+        flush();
+    }
+
+    void write(unsigned long long number, const vector<int> &way) {
+        size_t needed = max_way_length(way);
+        if(used_ + needed > buffer_.size()) {
+            flush();
+            if(needed > buffer_.size()) {
+                buffer_.resize(needed);
+            }
+        }
+        used_ = format_way(&buffer_[used_], number, way, pad_) - &buffer_[0];
+    }
+
+    void flush() {
+        out_.write(&buffer_[0], used_);
+        out_.flush();
+        used_ = 0;
+    }
+
+private:
+    static const size_t BUFFER_SIZE = 1 << 20;
+
+    bool pad_;
+    ostream &out_;
+    vector<char> buffer_;
+    size_t used_;
+};
+
 void display_ways(const vector< vector<int> > &ways) {
     // Displays the ways to climb stairs by iterating over
     // the vector of vectors and printing each combination.
-    for(int i = 0; i < (int) ways.size(); i++) {
-        // Number formatting for when there are more than 9 total ways
-        if((int) ways.size() > 9) {
-            if(i < 9) {
-                // If printing first 9 ways of the total ways
-                cout << " " << (i + 1) << ". " << "[";
-            } else {
-                // If not printing first 9 ways of the total ways
-                cout << (i + 1) << ". " << "[";
+    WayWriter writer(ways.size() > 9);
+    for(size_t i = 0; i < ways.size(); i++) {
+        writer.write(i + 1, ways[i]);
+    }
+}
+
+// Ways per shard in parallel display_ways(), and how many shards may be
+// finished but not yet written, per worker thread.
+const unsigned long long WAYS_PER_SHARD = 1 << 15;
+const size_t SHARDS_IN_FLIGHT_PER_THREAD = 4;
+
+/**
+ * Displays the ways as display_ways() does, using num_threads workers. The
+ * ways are split by rank into shards, i.e. contiguous runs of the enumeration
+ * tree sharing prefixes. Each worker claims the next shard, starts an
+ * enumerator at unrank_way() of its first way, and formats into its own
+ * buffer; the calling thread writes the buffers in shard order. At most a
+ * fixed number of shards are buffered at a time.
+ */
+void display_ways_parallel(int num_stairs, const vector<int> &step_sizes,
+                           unsigned num_threads, unsigned long long total, bool pad) {
+    const unsigned long long num_shards = (total + WAYS_PER_SHARD - 1) / WAYS_PER_SHARD;
+    const size_t window = num_threads * SHARDS_IN_FLIGHT_PER_THREAD;
+    vector<string> buffers(window);
+    vector<bool> ready(window, false);
+    unsigned long long next_shard = 0, written = 0;
+    mutex lock;
+    condition_variable changed;
+
+    auto worker = [&]() {
+        while(true) {
+            unsigned long long shard;
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [&]() {
+                    return next_shard == num_shards || next_shard < written + window;
+                });
+                if(next_shard == num_shards) {
+                    return;
+                }
+                shard = next_shard++;
             }
-        } else {
-            // Number formating for when there aren't more than 9 total ways
-            cout << (i + 1) << ". " << "[";
-        }
-        
-        // Printing actual steps
-        for(int j = 0; j < (int) ways[i].size(); j++) {
-            if(j != ((int) ways[i].size()) - 1) {
-                cout << ways[i][j] << ", ";
-            } else {
-                cout << ways[i][j];
+
+            string buffer;
+            unsigned long long first = shard * WAYS_PER_SHARD + 1;
+            unsigned long long last = min(total, first + WAYS_PER_SHARD - 1);
+            WayEnumerator ways(unrank_way(num_stairs, first, step_sizes), step_sizes);
+            for(unsigned long long i = first; i <= last && ways.next(); i++) {
+                append_way(buffer, i, ways.way(), pad);
             }
+
+            unique_lock<mutex> guard(lock);
+            buffers[shard % window].swap(buffer);
+            ready[shard % window] = true;
+            changed.notify_all();
+        }
+    };
+
+    vector<thread> workers;
+    for(unsigned t = 0; t < num_threads; t++) {
+        workers.push_back(thread(worker));
+    }
+    for(unsigned long long shard = 0; shard < num_shards; shard++) {
+        string buffer;
+        {
+            unique_lock<mutex> guard(lock);
+            changed.wait(guard, [&]() { return ready[shard % window]; });
+            buffer.swap(buffers[shard % window]);
+            ready[shard % window] = false;
+            written++;
+            changed.notify_all();
+        }
+        cout << buffer;
+    }
+    cout << flush;
+    for(size_t t = 0; t < workers.size(); t++) {
+        workers[t].join();
+    }
+}
+
+/**
+ * Displays the ways to climb num_stairs stairs as they are enumerated, without
+ * storing them. Output matches display_ways(get_ways(num_stairs, step_sizes)).
+ * With more than one thread and a count that fits in 64 bits, the enumeration
+ * is split across threads by display_ways_parallel().
+ */
+void display_ways(int num_stairs, const vector<int> &step_sizes = DEFAULT_STEPS,
+                  unsigned num_threads = 1) {
+    bool pad = count_ways(num_stairs, step_sizes).to_string().length() > 1;
+    if(num_threads > 1) {
+        unsigned long long total;
+        try {
+            total = way_counts(num_stairs, step_sizes)[num_stairs];
+        } catch(const out_of_range &) {
+            total = 0;
         }
-        cout << "]" << endl;
+        if(total > 0) {
+            display_ways_parallel(num_stairs, step_sizes, num_threads, total, pad);
+            return;
+        }
+    }
+
+    WayEnumerator ways(num_stairs, step_sizes);
+    WayWriter writer(pad);
+    for(unsigned long long i = 1; ways.next(); i++) {
+        writer.write(i, ways.way());
     }
 }
 
+/**
+ * Parses a comma-separated list of step sizes, e.g. "1,2,3", into sorted,
+ * distinct positive integers. Returns false if the list is malformed or a
+ * step does not fit in an int; steps longer than the climb are allowed and
+ * simply never taken.
+ */
+bool parse_steps(const string &list, vector<int> &step_sizes) {
+    istringstream iss(list);
+    string item;
+    step_sizes.clear();
+    while(getline(iss, item, ',')) {
+        istringstream item_iss(item);
+        int step;
+        if(!(item_iss >> step) || step <= 0 || !item_iss.eof()) {
+            return false;
+        }
+        step_sizes.push_back(step);
+    }
+    sort(step_sizes.begin(), step_sizes.end());
+    step_sizes.erase(unique(step_sizes.begin(), step_sizes.end()), step_sizes.end());
+    return !step_sizes.empty();
+}
+
 int main(int argc, char * const argv[]) {
 	int num_of_stairs;
     istringstream iss;
+    bool count_only = false;
+    vector<int> step_sizes = DEFAULT_STEPS;
+    unsigned num_threads = 1;
+
+    // Parsing options; the number of stairs must come last
+    int i = 1;
+    for(; i < argc - 1; i++) {
+        string option = argv[i];
+        if(option == "--count") {
+            count_only = true;
+        } else if(option == "--steps" && i + 1 < argc - 1) {
+            if(!parse_steps(argv[++i], step_sizes)) {
+                cerr << "Error: Step sizes must be positive integers." << endl;
+                return 1;
+            }
+        } else if(option == "--threads" && i + 1 < argc - 1) {
+            istringstream threads_iss(argv[++i]);
+            int threads;
+            if(!(threads_iss >> threads) || threads <= 0) {
+                cerr << "Error: Number of threads must be a positive integer." << endl;
+                return 1;
+            }
+            num_threads = threads;
+        } else {
+            break;
+        }
+    }
 
     // Checking if too many/no input arguments
-	if(argc != 2) {
-		cerr << "Usage: ./stairclimber <number of stairs>" << endl;
+	if(argc < 2 || i != argc - 1) {
+		cerr << "Usage: ./stairclimber [--count] [--steps <s1,s2,...>] "
+             << "[--threads <n>] <number of stairs>" << endl;
 		return 1;
 	}
 
     // Checking if input is not an int
-	iss.str(argv[1]);
+	iss.str(argv[argc - 1]);
 	if(!(iss >> num_of_stairs)) {
 		cerr << "Error: Number of stairs must be a positive integer." << endl;
 		return 1;
@@ -106,17 +566,16 @@ int main(int argc, char * const argv[]) {
         cerr << "Error: Number of stairs must be a positive integer." << endl;
         return 1;
     }
-	
-    // When input is valid:
-    vector<vector<int>> total_ways_final = get_ways(num_of_stairs);
-    
-    if(num_of_stairs == 1) {
-        cout << "1 way to climb 1 stair." << endl;
-    } else {
-        cout << total_ways_final.size() << " ways to climb " << num_of_stairs << " stairs." << endl;
-    }
-    
-    display_ways(total_ways_final);
+
+    // The count comes from count_ways(), so no paths are stored
+    string num_ways = count_ways(num_of_stairs, step_sizes).to_string();
+    cout << num_ways << (num_ways == "1" ? " way" : " ways") << " to climb "
+         << num_of_stairs << (num_of_stairs == 1 ? " stair." : " stairs.") << endl;
+
+    // Count-only mode: no paths are generated
+    if(!count_only) {
+        display_ways(num_of_stairs, step_sizes, num_threads);
+    }
 
     return 0;
 
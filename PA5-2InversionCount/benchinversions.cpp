@@ -0,0 +1,199 @@
+/*******************************************************************************
+ * Name        : benchinversions.cpp
+ * Description : Benchmarks the inversion counting engines over several input
+ *               distributions and sizes, reporting throughput and peak memory.
+ ******************************************************************************/
+#include "inversioncounter.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <random>
+#include <chrono>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+// The nested loop engine is skipped above this size. It takes about 0.1 s
+// at 10^4 values, but over 20 s per distribution at 10^5.
+const size_t SLOW_MAX_SIZE = 10000;
+
+enum distribution_t { SORTED, REVERSED, RANDOM, NEARLY_SORTED, DUPLICATES };
+const char * const DISTRIBUTION_NAMES[] = {
+    "sorted", "reversed", "random", "nearly-sorted", "duplicates"
+};
+
+/**
+ * Comparator that is not std::less, so int input goes through the generic
+ * engine instead of the integer fast path.
+ */
+struct IntLess {
+    bool operator()(int a, int b) const {
+        return a < b;
+    }
+};
+
+/**
+ * Fills values with length integers drawn from the given distribution.
+ */
+void generate(vector<int> &values, size_t length, distribution_t dist, mt19937_64 &rng) {
+    values.resize(length);
+    switch(dist) {
+        case SORTED:
+            for(size_t i = 0; i < length; i++) {
+                values[i] = (int) i;
+            }
+            break;
+        case REVERSED:
+            for(size_t i = 0; i < length; i++) {
+                values[i] = (int) (length - i);
+            }
+            break;
+        case RANDOM:
+            for(size_t i = 0; i < length; i++) {
+                values[i] = (int) rng();
+            }
+            break;
+        case NEARLY_SORTED:
+            // Sorted, then 1% of the positions swapped with a random partner
+            for(size_t i = 0; i < length; i++) {
+                values[i] = (int) i;
+            }
+            for(size_t i = 0; i < length / 100; i++) {
+                swap(values[rng() % length], values[rng() % length]);
+            }
+            break;
+        case DUPLICATES:
+            // Only 16 distinct values
+            for(size_t i = 0; i < length; i++) {
+                values[i] = (int) (rng() % 16);
+            }
+            break;
+    }
+}
+
+/**
+ * What a benchmark child sends back to the parent through its pipe.
+ */
+struct EngineResult {
+    double seconds;
+    inversion_count_t inversions;
+};
+
+/**
+ * Copies the input into the element type of the engine, runs the engine once
+ * and prints one result row with the number of inversions in numOfInv.
+ *
+ * ru_maxrss only ever grows, so the engine runs in a forked child and the
+ * peak is read from that child's usage: it covers what the process holds at
+ * the fork (mainly the input) plus the engine's copy and scratch, and no
+ * earlier engine's. Returns false if the child fails.
+ */
+template <typename T, typename Compare>
+bool run_engine(const string &name, const vector<int> &input, bool slow, Compare comp,
+                inversion_count_t &numOfInv) {
+    int fds[2];
+    if(pipe(fds) != 0) {
+        cerr << "Error: Cannot create a pipe for engine '" << name << "'." << endl;
+        return false;
+    }
+    cout << flush;
+    pid_t pid = fork();
+    if(pid < 0) {
+        cerr << "Error: Cannot fork for engine '" << name << "'." << endl;
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if(pid == 0) {
+        close(fds[0]);
+        vector<T> work(input.begin(), input.end());
+        size_t length = work.size();
+        EngineResult result;
+
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        result.inversions = slow ? count_inversions_slow(&work[0], length, comp)
+                                 : count_inversions_fast(&work[0], length, comp);
+        chrono::steady_clock::time_point end = chrono::steady_clock::now();
+        result.seconds = chrono::duration<double>(end - start).count();
+
+        bool written = write(fds[1], &result, sizeof(result)) == (ssize_t) sizeof(result);
+        _exit(written ? 0 : 1);
+    }
+
+    close(fds[1]);
+    EngineResult result;
+    bool received = read(fds[0], &result, sizeof(result)) == (ssize_t) sizeof(result);
+    close(fds[0]);
+    int status;
+    struct rusage usage;
+    if(wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status) ||
+       WEXITSTATUS(status) != 0 || !received) {
+        cerr << "Error: Engine '" << name << "' did not finish." << endl;
+        return false;
+    }
+    numOfInv = result.inversions;
+
+    // ru_maxrss is reported in kilobytes on Linux
+    cout << "  " << left << setw(14) << name << right
+         << setw(12) << fixed << setprecision(4) << result.seconds << " s"
+         << setw(14) << scientific << setprecision(3) << (input.size() / result.seconds) << " elem/s"
+         << setw(10) << fixed << setprecision(1) << usage.ru_maxrss / 1024.0 << " MB peak"
+         << "   inversions: " << numOfInv << endl;
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_size = 10000000;
+
+    if(argc > 2) {
+        cerr << "Usage: ./benchinversions [max size]" << endl;
+        return 1;
+    }
+    if(argc == 2) {
+        istringstream iss(argv[1]);
+        if(!(iss >> max_size) || max_size < 1000) {
+            cerr << "Error: Max size must be an integer of at least 1000." << endl;
+            return 1;
+        }
+    }
+
+    mt19937_64 rng(20231118);
+    vector<int> input;
+    bool mismatch = false;
+
+    for(size_t length = 1000; length <= max_size; length *= 10) {
+        for(int d = SORTED; d <= DUPLICATES; d++) {
+            generate(input, length, (distribution_t) d, rng);
+            cout << "n = " << length << ", " << DISTRIBUTION_NAMES[d] << endl;
+
+            inversion_count_t expected, generic, int64, dbl, slow;
+            if(!run_engine<int>("fast", input, false, less<int>(), expected) ||
+               !run_engine<int>("fast-generic", input, false, IntLess(), generic) ||
+               !run_engine<long long>("fast-int64", input, false, less<long long>(), int64) ||
+               !run_engine<double>("fast-double", input, false, less<double>(), dbl)) {
+                return 1;
+            }
+            if(generic != expected || int64 != expected || dbl != expected) {
+                mismatch = true;
+            }
+            if(length <= SLOW_MAX_SIZE) {
+                if(!run_engine<int>("slow", input, true, less<int>(), slow)) {
+                    return 1;
+                }
+                if(slow != expected) {
+                    mismatch = true;
+                }
+            }
+        }
+    }
+
+    if(mismatch) {
+        cerr << "Error: Engines disagree on the number of inversions." << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -2,6 +2,7 @@
  * Name        : inversioncounter.cpp
  * Description : Counts the number of inversions in an array.
  ******************************************************************************/
+#include "inversioncounter.h"
 #include <iostream>
 #include <algorithm>
 #include <sstream>
@@ -12,87 +13,6 @@
 
 using namespace std;
 
-// Function prototype.
-static long mergesort(int array[], int scratch[], int low, int high);
-
-/**
- * Counts the number of inversions in an array in Theta(n^2) time using two nested loops.
- */
-long count_inversions_slow(int array[], int length) {
-    // TODO
-    // Initializing variable to keep count of the number of inversions
-    long numOfInv = 0;
-
-    // Using nested loop to find number of inversions
-    for(int i = 0; i < length; i++) {
-        for (int j = i + 1; j < length; j++) {
-            // Checking if array[i] and array[j] are in order; if not, increment numOfInv
-            if(array[i] > array[j]) {
-                numOfInv++;
-            }
-        }
-    }
-
-    return numOfInv;
-}
-
-/**
- * Counts the number of inversions in an array in Theta(n lg n) time.
- */
-long count_inversions_fast(int array[], int length) {
-    // TODO
-    // Hint: Use mergesort!
-
-    // Initializing empty array (scratch) of same length as array
-    int* scratch = new int[length];
-    // Finding numOfInv using mergesort function
-    long numOfInv = mergesort(array, scratch, 0, length - 1);
-    // Deallocating memory used by array scratch
-    delete[] scratch;
-    return numOfInv;
-}
-
-static long mergesort(int array[], int scratch[], int low, int high) {
-    // TODO
-    long numOfInv = 0;
-    int mid;
-
-    if(low < high) {
-        // Finding middle of array; initializing necessary variables for mergesort
-        mid = low + (high - low)/2;
-        int L = low;
-        int H = mid + 1;
-
-        // Recursive calls for both halves of array
-        long numOfInvL = mergesort(array, scratch, low, mid);
-        long numOfInvR = mergesort(array, scratch, mid + 1, high);
-
-        // Adding numOfInv from recursive calls
-        numOfInv += numOfInvL + numOfInvR;
-
-        // Sorting array and counting/incrementing numOfInv as is necessary
-        for(int k = low; k <= high; k++) {
-            if(L <= mid && (H > high || array[L] <= array[H])) {
-                scratch[k] = array[L];
-                L = L + 1;
-            } else {
-                scratch[k] = array[H];
-                H = H + 1;
-                // Incrementing numOfInv by number of inversions solved via the sorting
-                numOfInv += mid - L + 1;
-            }
-        }
-
-        // Setting values in array to sorted values
-        for(int k = low; k <= high; k++) {
-            array[k] = scratch[k];
-        }
-    }
-    return numOfInv;
-}
-
-
-
 int main(int argc, char *argv[]) {
     // TODO: parse command-line argument
 
@@ -145,8 +65,8 @@ int main(int argc, char *argv[]) {
     }
 
     // TODO: produce output
-    long numOfInv;
-    int length = values.size();
+    inversion_count_t numOfInv;
+    size_t length = values.size();
 
     // Checking if no integers were input; throwing error if so
     if(length == 0) {
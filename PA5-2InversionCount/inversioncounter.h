@@ -0,0 +1,189 @@
+/*******************************************************************************
+ * Name        : inversioncounter.h
+ * Description : Inversion counting engines, templated over the element type
+ *               and comparator.
+ ******************************************************************************/
+#ifndef INVERSIONCOUNTER_H_
+#define INVERSIONCOUNTER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+// An array of n elements has at most n(n-1)/2 inversions, which for n up to
+// 2^32 is just under 2^63, so 64 bits is always enough.
+typedef unsigned long long inversion_count_t;
+
+/**
+ * Counts the number of inversions in an array in Theta(n^2) time using two nested loops.
+ */
+template <typename T, typename Compare = std::less<T> >
+inversion_count_t count_inversions_slow(const T array[], size_t length,
+                                        Compare comp = Compare()) {
+    // Initializing variable to keep count of the number of inversions
+    inversion_count_t numOfInv = 0;
+
+    // Using nested loop to find number of inversions
+    for(size_t i = 0; i < length; i++) {
+        for (size_t j = i + 1; j < length; j++) {
+            // Checking if array[i] and array[j] are in order; if not, increment numOfInv
+            if(comp(array[j], array[i])) {
+                numOfInv++;
+            }
+        }
+    }
+
+    return numOfInv;
+}
+
+/**
+ * Generic mergesort engine. Works for any element type with a strict weak
+ * ordering, e.g. doubles or fixed-width string keys such as std::array<char, N>.
+ */
+template <typename T, typename Compare, bool IntegerPath>
+struct InversionCounter {
+    static inversion_count_t count(T array[], size_t length, Compare comp) {
+        if(length < 2) {
+            return 0;
+        }
+        // Initializing empty array (scratch) of same length as array
+        T* scratch = new T[length];
+        // Finding numOfInv using mergesort function
+        inversion_count_t numOfInv = mergesort(array, scratch, 0, length - 1, comp);
+        // Deallocating memory used by array scratch
+        delete[] scratch;
+        return numOfInv;
+    }
+
+private:
+    static inversion_count_t mergesort(T array[], T scratch[], size_t low,
+                                       size_t high, Compare &comp) {
+        inversion_count_t numOfInv = 0;
+
+        if(low < high) {
+            // Finding middle of array; initializing necessary variables for mergesort
+            size_t mid = low + (high - low)/2;
+            size_t L = low;
+            size_t H = mid + 1;
+
+            // Recursive calls for both halves of array
+            numOfInv += mergesort(array, scratch, low, mid, comp);
+            numOfInv += mergesort(array, scratch, mid + 1, high, comp);
+
+            // Sorting array and counting/incrementing numOfInv as is necessary
+            for(size_t k = low; k <= high; k++) {
+                if(L <= mid && (H > high || !comp(array[H], array[L]))) {
+                    scratch[k] = array[L];
+                    L = L + 1;
+                } else {
+                    scratch[k] = array[H];
+                    H = H + 1;
+                    // Incrementing numOfInv by number of inversions solved via the sorting
+                    numOfInv += mid - L + 1;
+                }
+            }
+
+            // Setting values in array to sorted values
+            for(size_t k = low; k <= high; k++) {
+                array[k] = scratch[k];
+            }
+        }
+        return numOfInv;
+    }
+};
+
+/**
+ * Integer fast path, used for integral types ordered by std::less. Sorts short
+ * runs with insertion sort (each shift is one inversion), then merges the runs
+ * bottom-up with a branchless merge, ping-ponging between the array and the
+ * scratch buffer instead of copying back after every merge.
+ */
+template <typename T, typename Compare>
+struct InversionCounter<T, Compare, true> {
+    static inversion_count_t count(T array[], size_t length, Compare) {
+        if(length < 2) {
+            return 0;
+        }
+        inversion_count_t numOfInv = 0;
+
+        for(size_t low = 0; low < length; low += RUN_LENGTH) {
+            numOfInv += insertion_sort(array, low, std::min(low + RUN_LENGTH, length));
+        }
+        if(length <= RUN_LENGTH) {
+            return numOfInv;
+        }
+
+        T* scratch = new T[length];
+        T *src = array, *dst = scratch;
+        for(size_t width = RUN_LENGTH; width < length; width *= 2) {
+            for(size_t low = 0; low < length; low += 2 * width) {
+                size_t mid = std::min(low + width, length);
+                size_t high = std::min(low + 2 * width, length);
+                numOfInv += merge(src, dst, low, mid, high);
+            }
+            std::swap(src, dst);
+        }
+        // After an odd number of passes the sorted data is in scratch
+        if(src != array) {
+            std::copy(src, src + length, array);
+        }
+        delete[] scratch;
+        return numOfInv;
+    }
+
+private:
+    static const size_t RUN_LENGTH = 32;
+
+    static inversion_count_t insertion_sort(T array[], size_t low, size_t high) {
+        inversion_count_t numOfInv = 0;
+        for(size_t i = low + 1; i < high; i++) {
+            T value = array[i];
+            size_t j = i;
+            while(j > low && value < array[j - 1]) {
+                array[j] = array[j - 1];
+                j--;
+            }
+            numOfInv += i - j;
+            array[j] = value;
+        }
+        return numOfInv;
+    }
+
+    static inversion_count_t merge(const T src[], T dst[], size_t low,
+                                   size_t mid, size_t high) {
+        inversion_count_t numOfInv = 0;
+        size_t L = low, H = mid, k = low;
+
+        while(L < mid && H < high) {
+            const bool take_right = src[H] < src[L];
+            dst[k++] = take_right ? src[H] : src[L];
+            // Every element left in the left run is greater than src[H]
+            numOfInv += take_right ? (mid - L) : 0;
+            H += take_right;
+            L += !take_right;
+        }
+        while(L < mid) {
+            dst[k++] = src[L++];
+        }
+        while(H < high) {
+            dst[k++] = src[H++];
+        }
+        return numOfInv;
+    }
+};
+
+/**
+ * Counts the number of inversions in an array in Theta(n lg n) time.
+ * Sorts the array as a side effect.
+ */
+template <typename T, typename Compare = std::less<T> >
+inversion_count_t count_inversions_fast(T array[], size_t length,
+                                        Compare comp = Compare()) {
+    return InversionCounter<T, Compare,
+                            std::is_integral<T>::value &&
+                            std::is_same<Compare, std::less<T> >::value>
+           ::count(array, length, comp);
+}
+
+#endif /* INVERSIONCOUNTER_H_ */
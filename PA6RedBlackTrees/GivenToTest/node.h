@@ -10,19 +10,25 @@
 #define NODE_H_
 
 #include <cstdlib>
+#include <cstdint>
 #include <utility>
 
 enum { RED, BLACK };
 typedef unsigned char color_t;
 
+/**
+ * The color is kept in the low bit of the parent pointer, which is always 0
+ * because nodes are at least pointer aligned. With int keys and values this
+ * takes a node from 40 to 32 bytes, two per cache line.
+ */
 template<typename K, typename V>
 struct Node {
 public:
-    Node() : left{nullptr}, right{nullptr}, parent{nullptr}, color{RED} { }
+    Node() : left{nullptr}, right{nullptr}, parent_and_color_{RED} { }
 
     Node(const K &key, const V &value) :
-        left{nullptr}, right{nullptr}, parent{nullptr}, color{RED},
-        kv_pair_(std::make_pair(key, value)) { }
+        left{nullptr}, right{nullptr}, parent_and_color_{RED},
+        kv_pair_(key, value) { }
 
     inline const K& key() const {
         return kv_pair_.first;
@@ -36,10 +42,29 @@ public:
         kv_pair_.second = value;
     }
 
-    Node<K, V> *left, *right, *parent;
-    color_t color;
+    inline Node<K, V>* parent() const {
+        return reinterpret_cast<Node<K, V> *>(parent_and_color_ & ~COLOR_BIT);
+    }
+
+    inline void set_parent(Node<K, V> *parent) {
+        parent_and_color_ = reinterpret_cast<uintptr_t>(parent) | (parent_and_color_ & COLOR_BIT);
+    }
+
+    inline color_t color() const {
+        return (color_t) (parent_and_color_ & COLOR_BIT);
+    }
+
+    inline void set_color(color_t color) {
+        parent_and_color_ = (parent_and_color_ & ~COLOR_BIT) | color;
+    }
+
+    Node<K, V> *left, *right;
 
 private:
+    static const uintptr_t COLOR_BIT = 1;
+    static_assert(RED == 0 && BLACK == COLOR_BIT, "colors must match the parent pointer bit");
+
+    uintptr_t parent_and_color_;
     std::pair<K, V> kv_pair_;
 };
 
@@ -19,9 +19,15 @@
 #include <sstream>
 #include <algorithm>
 #include <utility>
+#include <vector>
+#include <new>
+#include <type_traits>
 
-// Forward declaration
 template <typename K, typename V>
+class NodePool;
+
+// Forward declaration
+template <typename K, typename V, typename Allocator = NodePool<K, V> >
 class RedBlackTree;
 
 /**
@@ -42,7 +48,112 @@ private:
     std::string message_;
 };
 
+/**
+ * Node allocator that calls new and delete once per node. Kept for
+ * comparison with NodePool and as an example of the allocator interface a
+ * RedBlackTree expects: create() and destroy() for single nodes, and
+ * release_all(), which frees whatever destroy() has not, at once if
+ * RELEASES_ALL is true (otherwise the tree destroys every node first).
+ */
 template <typename K, typename V>
+class HeapNodeAllocator {
+public:
+    static const bool RELEASES_ALL = false;
+
+    Node<K, V>* create(const K &key, const V &value) {
+        return new Node<K, V>(key, value);
+    }
+
+    void destroy(Node<K, V> *node) {
+        delete node;
+    }
+
+    void release_all() { }
+};
+
+/**
+ * Default node allocator: hands out nodes from large contiguous blocks, so
+ * allocation is a pointer bump, nodes inserted together sit together in
+ * memory, and the whole pool is freed in O(#blocks). Destroyed nodes go on a
+ * free list and are reused before the current block is touched. Blocks start
+ * at FIRST_BLOCK_NODES nodes and double up to MAX_BLOCK_NODES.
+ */
+template <typename K, typename V>
+class NodePool {
+public:
+    static const bool RELEASES_ALL = true;
+
+    NodePool() : free_{nullptr}, next_{nullptr}, end_{nullptr},
+                 block_nodes_{FIRST_BLOCK_NODES} { }
+
+    ~NodePool() {
+        release_all();
+    }
+
+    NodePool(const NodePool &) = delete;
+    NodePool& operator=(const NodePool &) = delete;
+
+    Node<K, V>* create(const K &key, const V &value) {
+        Slot *slot;
+        if(free_ != nullptr) {
+            slot = free_;
+            free_ = free_->next;
+        } else {
+            if(next_ == end_) {
+                grow();
+            }
+            slot = next_++;
+        }
+        return new (slot) Node<K, V>(key, value);
+    }
+
+    void destroy(Node<K, V> *node) {
+        node->~Node<K, V>();
+        Slot *slot = reinterpret_cast<Slot *>(node);
+        slot->next = free_;
+        free_ = slot;
+    }
+
+    /**
+     * Frees every block without running any node destructors; callers with
+     * non-trivial keys or values destroy their live nodes first.
+     */
+    void release_all() {
+        for(size_t i = 0; i < blocks_.size(); i++) {
+            ::operator delete(blocks_[i]);
+        }
+        blocks_.clear();
+        free_ = next_ = end_ = nullptr;
+        block_nodes_ = FIRST_BLOCK_NODES;
+    }
+
+private:
+    union Slot {
+        Slot *next;
+        typename std::aligned_storage<sizeof(Node<K, V>),
+                                      std::alignment_of< Node<K, V> >::value>::type node;
+    };
+
+    static const size_t FIRST_BLOCK_NODES = 64;
+    static const size_t MAX_BLOCK_NODES = 1 << 16;
+
+    std::vector<Slot *> blocks_;
+    Slot *free_;
+    Slot *next_, *end_;
+    size_t block_nodes_;
+
+    void grow() {
+        blocks_.reserve(blocks_.size() + 1);
+        next_ = static_cast<Slot *>(::operator new(block_nodes_ * sizeof(Slot)));
+        blocks_.push_back(next_);
+        end_ = next_ + block_nodes_;
+        if(block_nodes_ < MAX_BLOCK_NODES) {
+            block_nodes_ *= 2;
+        }
+    }
+};
+
+template <typename K, typename V, typename Allocator = NodePool<K, V> >
 class RedBlackTreeIterator {
 public:
     /**
@@ -116,10 +227,10 @@ public:
                 // root_parent_. A non-null parent is the successor. If parent
                 // is nullptr, the original node was the last node inorder, and
                 // its successor is the end of the list.
-                p = node_ptr->parent;
+                p = node_ptr->parent();
                 while (p != nullptr && node_ptr == p->right) {
                     node_ptr = p;
-                    p = p->parent;
+                    p = p->parent();
                 }
 
                 // If we were previously at the rightmost node in
@@ -149,21 +260,26 @@ private:
     // root pointer, which is needed for ++ and --
     // when the iterator value is end().
     Node<K, V> *node_ptr;
-    RedBlackTree<K, V> *tree;
-    friend class RedBlackTree<K, V>;
+    RedBlackTree<K, V, Allocator> *tree;
+    friend class RedBlackTree<K, V, Allocator>;
 
     /**
      * Constructor used to construct an iterator return value from a tree
      * pointer.
      */
-    RedBlackTreeIterator(Node<K, V> *p, RedBlackTree<K, V> *t) :
+    RedBlackTreeIterator(Node<K, V> *p, RedBlackTree<K, V, Allocator> *t) :
         node_ptr(p), tree(t) { }
 };
 
-template<typename K, typename V>
+/**
+ * Red-black tree whose nodes come from an Allocator; see HeapNodeAllocator
+ * for the interface. The default NodePool frees the whole tree in O(#blocks)
+ * when keys and values need no destructor.
+ */
+template<typename K, typename V, typename Allocator>
 class RedBlackTree : public Tree {
 public:
-    typedef RedBlackTreeIterator<K, V> iterator;
+    typedef RedBlackTreeIterator<K, V, Allocator> iterator;
 
     /**
      * Constructor to create an empty red-black tree.
@@ -172,7 +288,7 @@ public:
 
     /**
      * Constructor to create a red-black tree with the elements from the
-     * vector.
+     * vector, built in one pass by insert_elements().
      */
     explicit RedBlackTree(std::vector< std::pair<K, V> > &elements) :
                                             root_(nullptr), size_(0) {
@@ -183,14 +299,19 @@ public:
      * Destructor.
      */
     ~RedBlackTree() {
-        delete_tree(root_);
+        delete_tree();
     }
 
     /**
      * Inserts elements from the vector into the red-black tree.
-     * Duplicate elements are not inserted.
+     * Duplicate elements are not inserted. An empty tree is bulk loaded
+     * instead, with the same result and warnings as inserting one by one.
      */
     void insert_elements(std::vector< std::pair<K, V> > &elements) {
+        if(root_ == nullptr) {
+            bulk_load(elements);
+            return;
+        }
         for (size_t i = 0, len = elements.size(); i < len; ++i) {
             try {
                 insert(elements[i].first, elements[i].second);
@@ -214,7 +335,7 @@ public:
             Node<K, V> *x, *y;
             if (it != end()) {
                 x = it.node_ptr;
-                y = x->parent;
+                y = x->parent();
             } else {
                 x = root_;
                 y = nullptr;
@@ -228,13 +349,11 @@ public:
                     x = x->right;
                 } else {
                     // When key == x.key
-                    std::ostringstream exceptStr;
-                    exceptStr << "Attempt to insert duplicate key '" << key << "'.";
-                    throw tree_exception(exceptStr.str());
+                    throw tree_exception(duplicate_key_message(key));
                 }
             }
-            Node<K, V> *keyVal = new Node<K, V>(key, key_value.second);
-            keyVal->parent = y;
+            Node<K, V> *keyVal = alloc_.create(key, key_value.second);
+            keyVal->set_parent(y);
             if(y == nullptr) {
                 root_ = keyVal;
             } else if(key < y->key()) {
@@ -244,7 +363,7 @@ public:
             }
             keyVal->left = nullptr;
             keyVal->right = nullptr;
-            keyVal->color = RED;
+            keyVal->set_color(RED);
             insert_fixup(keyVal);
         }
         size_++;
@@ -336,6 +455,74 @@ public:
         return (double)sum_null_levels() / null_count();
     }
 
+    /**
+     * Removes key from the red-black tree, returning the number of nodes
+     * removed (0 or 1).
+     */
+    size_t erase(const K &key) {
+        iterator it = find(key);
+        if(it == end()) {
+            return 0;
+        }
+        erase(it);
+        return 1;
+    }
+
+    /**
+     * Removes the node at it from the red-black tree, as in RB-DELETE on
+     * p. 324 of CLRS, and returns an iterator to the node after it. Nodes
+     * are relinked rather than having keys copied between them, so other
+     * iterators stay valid. The node goes back to the allocator.
+     */
+    iterator erase(iterator it) {
+        Node<K, V> *z = it.node_ptr;
+        if(z == nullptr) {
+            throw tree_exception("RedBlackTree erase(): cannot erase end()");
+        }
+        ++it;
+
+        // With nullptr standing in for T.nil, x may be null, so its parent
+        // is tracked separately in x_parent
+        Node<K, V> *y = z, *x, *x_parent;
+        color_t y_original_color = y->color();
+        if(z->left == nullptr) {
+            x = z->right;
+            x_parent = z->parent();
+            transplant(z, z->right);
+        } else if(z->right == nullptr) {
+            x = z->left;
+            x_parent = z->parent();
+            transplant(z, z->left);
+        } else {
+            // y is z's successor, the minimum of its right subtree
+            y = z->right;
+            while(y->left != nullptr) {
+                y = y->left;
+            }
+            y_original_color = y->color();
+            x = y->right;
+            if(y->parent() == z) {
+                x_parent = y;
+            } else {
+                x_parent = y->parent();
+                transplant(y, y->right);
+                y->right = z->right;
+                y->right->set_parent(y);
+            }
+            transplant(z, y);
+            y->left = z->left;
+            y->left->set_parent(y);
+            y->set_color(z->color());
+        }
+        if(y_original_color == BLACK) {
+            delete_fixup(x, x_parent);
+        }
+
+        alloc_.destroy(z);
+        size_--;
+        return iterator(it.node_ptr, this);
+    }
+
     /**
      * Searches for item. If found, returns an iterator pointing
      * at it in the tree; otherwise, returns end().
@@ -383,7 +570,103 @@ public:
 private:
     Node<K, V> *root_;
     size_t size_;
-    friend class RedBlackTreeIterator<K, V>;
+    Allocator alloc_;
+    friend class RedBlackTreeIterator<K, V, Allocator>;
+
+    static std::string duplicate_key_message(const K &key) {
+        std::ostringstream exceptStr;
+        exceptStr << "Attempt to insert duplicate key '" << key << "'.";
+        return exceptStr.str();
+    }
+
+    /**
+     * Builds the tree, which must be empty, from elements in O(n) time after
+     * sorting them, and skips the sort when the keys are already strictly
+     * increasing. The first occurrence of a key wins; later ones get the
+     * warning insert() would have raised, in input order. Like insert(),
+     * K{} keys add no node but are still counted in size_.
+     */
+    void bulk_load(const std::vector< std::pair<K, V> > &elements) {
+        // Indices of the elements to place, to be put in key order
+        std::vector<size_t> order;
+        order.reserve(elements.size());
+        size_t empty_keys = 0;
+        bool sorted = true;
+        for(size_t i = 0; i < elements.size(); i++) {
+            if(elements[i].first == K{}) {
+                empty_keys++;
+                continue;
+            }
+            if(!order.empty() && !(elements[order.back()].first < elements[i].first)) {
+                sorted = false;
+            }
+            order.push_back(i);
+        }
+
+        if(!sorted) {
+            // Stable, so each run of equal keys starts with its first occurrence
+            std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+                return elements[a].first < elements[b].first;
+            });
+            std::vector<size_t> duplicates;
+            size_t kept = 0;
+            for(size_t i = 0; i < order.size(); i++) {
+                if(kept > 0 && !(elements[order[kept - 1]].first < elements[order[i]].first)) {
+                    duplicates.push_back(order[i]);
+                } else {
+                    order[kept++] = order[i];
+                }
+            }
+            order.resize(kept);
+            std::sort(duplicates.begin(), duplicates.end());
+            for(size_t i = 0; i < duplicates.size(); i++) {
+                std::cerr << "Warning: " << duplicate_key_message(elements[duplicates[i]].first)
+                          << std::endl;
+            }
+        }
+
+        // Levels 0 to full_levels - 1 come out complete. Coloring the nodes
+        // of a last, partial level red gives every path to a null the same
+        // number of black nodes, and red nodes there have no children.
+        size_t full_levels = 0;
+        while(((size_t) 2 << full_levels) - 1 <= order.size()) {
+            full_levels++;
+        }
+        root_ = build_balanced(elements, order, 0, order.size(), nullptr, 0, full_levels);
+        size_ += order.size() + empty_keys;
+    }
+
+    /**
+     * Builds a perfectly balanced subtree from the elements order[low] to
+     * order[high - 1], rooted at the middle one.
+     */
+    Node<K, V>* build_balanced(const std::vector< std::pair<K, V> > &elements,
+                               const std::vector<size_t> &order, size_t low, size_t high,
+                               Node<K, V> *parent, size_t depth, size_t red_depth) {
+        if(low >= high) {
+            return nullptr;
+        }
+        size_t mid = low + (high - low) / 2;
+        Node<K, V> *node = alloc_.create(elements[order[mid]].first, elements[order[mid]].second);
+        node->set_parent(parent);
+        node->set_color(depth == red_depth ? RED : BLACK);
+        node->left = build_balanced(elements, order, low, mid, node, depth + 1, red_depth);
+        node->right = build_balanced(elements, order, mid + 1, high, node, depth + 1, red_depth);
+        return node;
+    }
+
+    /**
+     * Deletes all nodes from the red-black tree. Nodes are destroyed one by
+     * one only when they have destructors to run or the allocator cannot
+     * free everything at once.
+     */
+    void delete_tree() {
+        if(!Allocator::RELEASES_ALL || !std::is_trivially_destructible< Node<K, V> >::value) {
+            delete_tree(root_);
+        }
+        alloc_.release_all();
+        root_ = nullptr;
+    }
 
     /**
      * Deletes all nodes from the red-black tree.
@@ -395,7 +678,7 @@ private:
             delete_tree(n->left);
             delete_tree(n->right);
             // Deleting current node after deleting all children
-            delete n;
+            alloc_.destroy(n);
         }
     }
 
@@ -404,44 +687,129 @@ private:
      */
     void insert_fixup(Node<K, V> *z) {
         // TODO
-        while((z->parent != nullptr) && (z->parent->color == RED)) {
-            if(z->parent == ((z->parent)->parent)->left) {
-                Node<K, V> *y = ((z->parent)->parent)->right;
-                if((y != nullptr) && (y->color == RED)) {
-                    z->parent->color = BLACK;
-                    y->color = BLACK;
-                    z->parent->parent->color = RED;
-                    z = z->parent->parent;
+        while((z->parent() != nullptr) && (z->parent()->color() == RED)) {
+            if(z->parent() == ((z->parent())->parent())->left) {
+                Node<K, V> *y = ((z->parent())->parent())->right;
+                if((y != nullptr) && (y->color() == RED)) {
+                    z->parent()->set_color(BLACK);
+                    y->set_color(BLACK);
+                    z->parent()->parent()->set_color(RED);
+                    z = z->parent()->parent();
                 } else {
-                    if (z == z->parent->right) {
-                        z = z->parent;
+                    if (z == z->parent()->right) {
+                        z = z->parent();
                         left_rotate(z);
                     }
-                    z->parent->color = BLACK;
-                    z->parent->parent->color = RED;
-                    right_rotate(z->parent->parent);
+                    z->parent()->set_color(BLACK);
+                    z->parent()->parent()->set_color(RED);
+                    right_rotate(z->parent()->parent());
                 }
             } else {
                 // Same as "then" clause, but with "right" and "left" exchanged
-                Node<K, V> *y = ((z->parent)->parent)->left;
-                if((y != nullptr) && (y->color == RED)) {
-                    z->parent->color = BLACK;
-                    y->color = BLACK;
-                    z->parent->parent->color = RED;
-                    z = z->parent->parent;
+                Node<K, V> *y = ((z->parent())->parent())->left;
+                if((y != nullptr) && (y->color() == RED)) {
+                    z->parent()->set_color(BLACK);
+                    y->set_color(BLACK);
+                    z->parent()->parent()->set_color(RED);
+                    z = z->parent()->parent();
                 } else {
-                    if(z == z->parent->left) {
-                        z = z->parent;
+                    if(z == z->parent()->left) {
+                        z = z->parent();
                         right_rotate(z);
                     }
-                    z->parent->color = BLACK;
-                    z->parent->parent->color = RED;
-                    left_rotate(z->parent->parent);
+                    z->parent()->set_color(BLACK);
+                    z->parent()->parent()->set_color(RED);
+                    left_rotate(z->parent()->parent());
                 }
             }
         }
         // Last line below
-        root_->color = BLACK;
+        root_->set_color(BLACK);
+    }
+
+    /**
+     * Replaces the subtree rooted at u with the one rooted at v, as on
+     * p. 323 of CLRS; v may be null.
+     */
+    void transplant(Node<K, V> *u, Node<K, V> *v) {
+        if(u->parent() == nullptr) {
+            root_ = v;
+        } else if(u == u->parent()->left) {
+            u->parent()->left = v;
+        } else {
+            u->parent()->right = v;
+        }
+        if(v != nullptr) {
+            v->set_parent(u->parent());
+        }
+    }
+
+    static bool is_black(Node<K, V> *node) {
+        return node == nullptr || node->color() == BLACK;
+    }
+
+    /**
+     * Fixup method described on p. 326 of CLRS. x carries the extra black
+     * and may be null, so x_parent is its parent.
+     */
+    void delete_fixup(Node<K, V> *x, Node<K, V> *x_parent) {
+        while(x != root_ && is_black(x)) {
+            if(x == x_parent->left) {
+                Node<K, V> *w = x_parent->right;
+                if(w->color() == RED) {
+                    w->set_color(BLACK);
+                    x_parent->set_color(RED);
+                    left_rotate(x_parent);
+                    w = x_parent->right;
+                }
+                if(is_black(w->left) && is_black(w->right)) {
+                    w->set_color(RED);
+                    x = x_parent;
+                    x_parent = x->parent();
+                } else {
+                    if(is_black(w->right)) {
+                        w->left->set_color(BLACK);
+                        w->set_color(RED);
+                        right_rotate(w);
+                        w = x_parent->right;
+                    }
+                    w->set_color(x_parent->color());
+                    x_parent->set_color(BLACK);
+                    w->right->set_color(BLACK);
+                    left_rotate(x_parent);
+                    x = root_;
+                }
+            } else {
+                // Same as "then" clause, but with "right" and "left" exchanged
+                Node<K, V> *w = x_parent->left;
+                if(w->color() == RED) {
+                    w->set_color(BLACK);
+                    x_parent->set_color(RED);
+                    right_rotate(x_parent);
+                    w = x_parent->left;
+                }
+                if(is_black(w->right) && is_black(w->left)) {
+                    w->set_color(RED);
+                    x = x_parent;
+                    x_parent = x->parent();
+                } else {
+                    if(is_black(w->left)) {
+                        w->right->set_color(BLACK);
+                        w->set_color(RED);
+                        left_rotate(w);
+                        w = x_parent->left;
+                    }
+                    w->set_color(x_parent->color());
+                    x_parent->set_color(BLACK);
+                    w->left->set_color(BLACK);
+                    right_rotate(x_parent);
+                    x = root_;
+                }
+            }
+        }
+        if(x != nullptr) {
+            x->set_color(BLACK);
+        }
     }
 
     /**
@@ -453,20 +821,20 @@ private:
         x->right = y->left;
 
         if(y->left != nullptr) {
-            y->left->parent = x;
+            y->left->set_parent(x);
         }
 
-        y->parent = x->parent;
-        if(x->parent == nullptr) {
+        y->set_parent(x->parent());
+        if(x->parent() == nullptr) {
             root_ = y;
-        } else if(x == x->parent->left) {
-            x->parent->left = y;
+        } else if(x == x->parent()->left) {
+            x->parent()->left = y;
         } else {
-            x->parent->right = y;
+            x->parent()->right = y;
         }
 
         y->left = x;
-        x->parent = y;
+        x->set_parent(y);
     }
 
     /**
@@ -478,20 +846,20 @@ private:
         x->left = y->right;
 
         if(y->right != nullptr) {
-            y->right->parent = x;
+            y->right->set_parent(x);
         }
         
-        y->parent = x->parent;
-        if(x->parent == nullptr) {
+        y->set_parent(x->parent());
+        if(x->parent() == nullptr) {
             root_ = y;
-        } else if(x == x->parent->right) {
-            x->parent->right = y;
+        } else if(x == x->parent()->right) {
+            x->parent()->right = y;
         } else {
-            x->parent->left = y;
+            x->parent()->left = y;
         }
 
         y->right = x;
-        x->parent = y;
+        x->set_parent(y);
     }
 
     /**